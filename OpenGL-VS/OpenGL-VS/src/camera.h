@@ -5,6 +5,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "frustum_culling.h"
+
 // Define several possible options for camera movement. Used to abstract to stay away from window-system specific input methods
 enum Camera_Movement {
 	FORWARD,
@@ -19,96 +21,225 @@ const float PITCH = 0.0f;
 const float SPEED = 2.5f;
 const float SENSITIVITY = 0.1f;
 const float ZOOM = 45.0f;
+const float ASPECT = 800.0f / 600.0f;
+const float Z_NEAR = 0.1f;
+const float Z_FAR = 100.0f;
+
+// Everything the simulation moves, a render camera is placed between two of these
+struct CameraState
+{
+	glm::vec3 position;
+	float yaw;
+	float pitch;
+	float zoom;
+
+	static CameraState Interpolate(const CameraState& previous, const CameraState& current, float alpha)
+	{
+		CameraState state;
+		state.position = previous.position + (current.position - previous.position) * alpha;
+		state.yaw = previous.yaw + (current.yaw - previous.yaw) * alpha; // yaw is never wrapped, no shortest-arc needed
+		state.pitch = previous.pitch + (current.pitch - previous.pitch) * alpha;
+		state.zoom = previous.zoom + (current.zoom - previous.zoom) * alpha;
+		return state;
+	}
+};
 
 // An abstract camera class that processes input and calculates the corresponding Euler Angles, Vectors and Matrices for use in OpenGL
+//
+// The pose (position, yaw, pitch) and lens (zoom, aspect, clip planes) are only changed through
+// the methods below, which mark what they touched dirty. The direction vectors and the view,
+// projection and view-projection matrices (plus inverses) are rebuilt lazily on the next read,
+// and only when an input really changed. GetVersion() moves whenever they did, so other systems
+// can skip their own per-frame work while it stays the same.
 class Camera
 {
 public :
-	// Camera Attributes
-	glm::vec3 Position;
-	glm::vec3 Front;
-	glm::vec3 Up;
-	glm::vec3 Right;
-	glm::vec3 WorldUp;
-	// Euler Angles
-	float Yaw;
-	float Pitch;
 	// Camera options
 	float MovementSpeed;
 	float MouseSensitivity;
-	float Zoom;
+
 	// Constructor with vectors
 	Camera(glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f), float yaw = YAW, float pitch = PITCH)
-		: Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM)
+		: MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Position(position), WorldUp(up), Yaw(yaw), Pitch(pitch)
 	{
-		Position = position;
-		WorldUp = up;
-		Yaw = yaw;
-		Pitch = pitch;
-		updateCameraVectors();
 	}
 
 	// Constructor with scalar values
 	Camera(float posX, float posY, float posZ, float upX, float upY, float upZ, float yaw, float pitch)
-		: Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM)
+		: Camera(glm::vec3(posX, posY, posZ), glm::vec3(upX, upY, upZ), yaw, pitch)
+	{
+	}
+
+	// ---- pose ----------------------------------------------------------------------
+
+	const glm::vec3& GetPosition() const { return Position; }
+	float GetYaw() const { return Yaw; }
+	float GetPitch() const { return Pitch; }
+
+	const glm::vec3& GetFront() const { updateCameraVectors(); return Front; }
+	const glm::vec3& GetRight() const { updateCameraVectors(); return Right; }
+	const glm::vec3& GetUp() const { updateCameraVectors(); return Up; }
+
+	void SetPosition(const glm::vec3& position)
 	{
-		Position = glm::vec3(posX, posY, posZ);
-		WorldUp = glm::vec3(upX, upY, upZ);
+		if (position == Position)
+			return;
+		Position = position;
+		viewDirty = true;
+	}
+
+	void SetOrientation(float yaw, float pitch)
+	{
+		if (yaw == Yaw && pitch == Pitch)
+			return;
 		Yaw = yaw;
 		Pitch = pitch;
-		updateCameraVectors();
+		vectorsDirty = true;
+		viewDirty = true;
+	}
+
+	// ---- lens ----------------------------------------------------------------------
+
+	float GetZoom() const { return Zoom; }
+	float GetAspect() const { return Aspect; }
+	float GetZNear() const { return ZNear; }
+	float GetZFar() const { return ZFar; }
+
+	void SetZoom(float zoom)
+	{
+		if (zoom < 1.0f)
+			zoom = 1.0f;
+		if (zoom > 45.0f)
+			zoom = 45.0f;
+		if (zoom == Zoom)
+			return;
+		Zoom = zoom;
+		projectionDirty = true;
+	}
+
+	// width / height of the framebuffer, call on resize
+	void SetAspect(float aspect)
+	{
+		if (aspect == Aspect || !(aspect > 0.0f))
+			return;
+		Aspect = aspect;
+		projectionDirty = true;
 	}
 
+	void SetClipPlanes(float zNear, float zFar)
+	{
+		if (zNear == ZNear && zFar == ZFar)
+			return;
+		ZNear = zNear;
+		ZFar = zFar;
+		projectionDirty = true;
+	}
+
+	// ---- cached matrices -------------------------------------------------------------
+
 	// Returns the view matrix calculated using Euler Angles and the LookAt Matrix
-	glm::mat4 GetViewMatrix()
+	const glm::mat4& GetViewMatrix() const { update(); return View; }
+	const glm::mat4& GetProjectionMatrix() const { update(); return Projection; }
+	const glm::mat4& GetViewProjectionMatrix() const { update(); return ViewProjection; }
+	const glm::mat4& GetInverseViewMatrix() const { update(); return InverseView; }
+	const glm::mat4& GetInverseProjectionMatrix() const { update(); return InverseProjection; }
+	const glm::mat4& GetInverseViewProjectionMatrix() const { update(); return InverseViewProjection; }
+
+	// World space frustum planes, re-extracted only when the view-projection changed
+	const Frustum& GetFrustum() const { update(); return CachedFrustum; }
+
+	// changes every time the matrices change, never while they stay the same
+	unsigned int GetVersion() const { update(); return Version; }
+
+	CameraState GetState() const
+	{
+		return CameraState{ Position, Yaw, Pitch, Zoom };
+	}
+
+	void SetState(const CameraState& state)
 	{
-		return glm::lookAt(Position, Position + Front, Up);
+		SetPosition(state.position);
+		SetOrientation(state.yaw, state.pitch);
+		SetZoom(state.zoom);
 	}
 
+	// ---- input -----------------------------------------------------------------------
+
 	// Processes input received from any keyboard-like input system. Accepts input parameter in the form of camera defined ENUM (to abstract it from windowing systems)
 	void ProcessKeyboard(Camera_Movement direction, float deltaTime)
 	{
 		float velocity = MovementSpeed * deltaTime;
+		glm::vec3 position = Position;
 		if (direction == FORWARD)
-			Position += Front * velocity;
+			position += GetFront() * velocity;
 		if (direction == BACKWARD)
-			Position -= Front * velocity;
+			position -= GetFront() * velocity;
 		if (direction == LEFT)
-			Position -= Right * velocity;
+			position -= GetRight() * velocity;
 		if (direction == RIGHT)
-			Position += Right * velocity;
+			position += GetRight() * velocity;
+		SetPosition(position);
 	}
 
 	// Processes input received from a mouse input system. Expects the offset value in both the x and y direction.
+	// Only the angles change here, the trig runs once when the vectors are next needed.
 	void ProcessMouseMovement(float xoffset, float yoffset, GLboolean constrainPitch = true)
 	{
 		xoffset *= MouseSensitivity;
 		yoffset *= MouseSensitivity;
-		Yaw += xoffset;
-		Pitch += yoffset;
+		float yaw = Yaw + xoffset;
+		float pitch = Pitch + yoffset;
 		if (constrainPitch) {
-			if (Pitch > 89.0f)
-				Pitch = 89.0f;
-			if (Pitch < -89.0f)
-				Pitch = -89.0f;
+			if (pitch > 89.0f)
+				pitch = 89.0f;
+			if (pitch < -89.0f)
+				pitch = -89.0f;
 		}
-		updateCameraVectors();
+		SetOrientation(yaw, pitch);
 	}
+
 	void ProcessMouseScroll(float yoffset)
 	{
-		Zoom -= (float)yoffset;
-		if (Zoom < 1.0f)
-			Zoom = 1.0f;
-		if (Zoom > 45.0f)
-			Zoom = 45.0f;
-
+		SetZoom(Zoom - (float)yoffset);
 	}
 
 
-private :	
+private :
+	// Camera Attributes
+	glm::vec3 Position;
+	glm::vec3 WorldUp;
+	// Euler Angles
+	float Yaw;
+	float Pitch;
+	// Lens
+	float Zoom = ZOOM;
+	float Aspect = ASPECT;
+	float ZNear = Z_NEAR;
+	float ZFar = Z_FAR;
+
+	// derived state, rebuilt on demand
+	mutable glm::vec3 Front = glm::vec3(0.0f, 0.0f, -1.0f);
+	mutable glm::vec3 Up = glm::vec3(0.0f, 1.0f, 0.0f);
+	mutable glm::vec3 Right = glm::vec3(1.0f, 0.0f, 0.0f);
+	mutable glm::mat4 View = glm::mat4(1.0f);
+	mutable glm::mat4 Projection = glm::mat4(1.0f);
+	mutable glm::mat4 ViewProjection = glm::mat4(1.0f);
+	mutable glm::mat4 InverseView = glm::mat4(1.0f);
+	mutable glm::mat4 InverseProjection = glm::mat4(1.0f);
+	mutable glm::mat4 InverseViewProjection = glm::mat4(1.0f);
+	mutable Frustum CachedFrustum = Frustum();
+	mutable unsigned int Version = 0;
+
+	mutable bool vectorsDirty = true;
+	mutable bool viewDirty = true;
+	mutable bool projectionDirty = true;
+
 	// Calculates the front vector from the Camera's (updated) Euler Angles
-	void updateCameraVectors()
+	void updateCameraVectors() const
 	{
+		if (!vectorsDirty)
+			return;
+		vectorsDirty = false;
 		// Calculate the new Front vector
 		glm::vec3 front;
 		front.x = cos(glm::radians(Yaw)) * cos(glm::radians(Pitch));
@@ -119,7 +250,29 @@ private :
 		Right = glm::normalize(glm::cross(Front, WorldUp));  // Normalize the vectors, because their length gets closer to 0 the more you look up or down which results in slower movement.
 		Up = glm::normalize(glm::cross(Right, Front));
 	}
+
+	// rebuilds whatever the last changes invalidated
+	void update() const
+	{
+		if (!viewDirty && !projectionDirty)
+			return;
+		if (viewDirty) {
+			updateCameraVectors();
+			View = glm::lookAt(Position, Position + Front, Up);
+			InverseView = glm::inverse(View);
+		}
+		if (projectionDirty) {
+			Projection = glm::perspective(glm::radians(Zoom), Aspect, ZNear, ZFar);
+			InverseProjection = glm::inverse(Projection);
+		}
+		ViewProjection = Projection * View;
+		InverseViewProjection = InverseView * InverseProjection;
+		CachedFrustum = Frustum::fromMatrix(ViewProjection);
+		viewDirty = false;
+		projectionDirty = false;
+		Version++;
+	}
 };
 
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,266 @@
+#ifndef DRAW_COMMANDS_H
+#define DRAW_COMMANDS_H
+
+#include <glad/glad.h> // include glad to get all the required OpenGL headers
+
+#include <glm/glm.hpp>
+
+#include "gl_extensions.h"
+#include "gl_state_cache.h"
+#include "geometry_arena.h"
+#include "shaders/shader_s.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Layout read by glMultiDrawElementsIndirect, one per draw
+struct DrawElementsIndirectCommand
+{
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;   // in indices of the draw's index type
+	GLint baseVertex;
+	GLuint baseInstance; // the draw ID, read back through the instanced aDrawID attribute
+};
+
+static_assert(sizeof(DrawElementsIndirectCommand) == 20, "DrawElementsIndirectCommand must match the GL layout");
+
+// Collects the draws of a frame (geometry arena ranges and their transforms) and submits
+// them with as few calls as the hardware allows.
+// Every draw gets an ID, its model and normal matrix go into one texture buffer that a
+// MULTI_DRAW shader permutation reads by that ID (include/draw_data.glsl), so nothing has to
+// change between draws. Consecutive draws of the same vertex format and index type go out as
+// one glMultiDrawElementsIndirect call, the ID riding in the command's baseInstance.
+// Without GL 4.3 / ARB_multi_draw_indirect the same list is walked with one
+// glDrawElementsBaseVertex per draw and the ID in a uniform: GL 3.3 cannot hand each draw
+// of a multi-draw its own ID, but the VAO, the textures and the draw data stay bound.
+// The caller binds the program and the textures, every draw of one submit() shares them.
+// The arena VAOs are shared with every other draw, aDrawID is only enabled during submit().
+class DrawCommandBuilder
+{
+public:
+	// vertex attribute of aDrawID, after the position / normal / texture coord of the arena
+	static const unsigned int DRAW_ID_LOCATION = 3;
+	// texture unit of the drawData buffer, clear of the material units
+	static const unsigned int DRAW_DATA_UNIT = 15;
+	// vec4 texels per draw : the model matrix then the normal matrix, one column each
+	static const unsigned int TEXELS_PER_DRAW = 8;
+
+	struct Stats
+	{
+		unsigned int draws = 0;
+		unsigned int calls = 0; // glMultiDrawElementsIndirect or glDrawElementsBaseVertex calls
+	};
+
+	void create(unsigned int initialCapacity = 1024)
+	{
+		capacity = initialCapacity > 0 ? initialCapacity : 1;
+
+		glGenBuffers(1, &dataBuffer);
+		glGenTextures(1, &dataTexture);
+		glGenBuffers(1, &drawIdBuffer);
+		if (glExt.multiDrawIndirect)
+			glGenBuffers(1, &indirectBuffer);
+		allocate();
+	}
+
+	void destroy()
+	{
+		glState.forgetTexture(dataTexture);
+		glDeleteTextures(1, &dataTexture);
+		for (GLuint* buffer : { &dataBuffer, &drawIdBuffer, &indirectBuffer }) {
+			if (*buffer) {
+				glState.forgetBuffer(*buffer);
+				glDeleteBuffers(1, buffer);
+			}
+			*buffer = 0;
+		}
+		dataTexture = 0;
+		for (GLuint& vao : attachedVertexArrays)
+			vao = 0;
+	}
+
+	// starts a new frame
+	void begin()
+	{
+		commands.clear();
+		batchKeys.clear();
+		drawData.clear();
+	}
+
+	// appends one draw of indexCount indices from firstIndex of the allocation and returns its ID
+	unsigned int add(const GeometryAllocation& allocation, size_t firstIndex, size_t indexCount, const glm::mat4& model)
+	{
+		return add(allocation, firstIndex, indexCount, model, glm::mat4(glm::transpose(glm::inverse(glm::mat3(model)))));
+	}
+
+	// same, with a normal matrix that is not the model's (quantized positions fold their bounds into model)
+	unsigned int add(const GeometryAllocation& allocation, size_t firstIndex, size_t indexCount,
+		const glm::mat4& model, const glm::mat4& normalMatrix)
+	{
+		unsigned int id = (unsigned int)commands.size();
+		DrawElementsIndirectCommand command;
+		command.count = (GLuint)indexCount;
+		command.instanceCount = 1;
+		command.firstIndex = (GLuint)(allocation.indexOffset / allocation.indexSize() + firstIndex);
+		command.baseVertex = (GLint)allocation.vertexOffset;
+		command.baseInstance = id;
+		commands.push_back(command);
+		batchKeys.push_back(batchKey(allocation));
+
+		drawData.resize(drawData.size() + TEXELS_PER_DRAW);
+		glm::vec4* texels = &drawData[drawData.size() - TEXELS_PER_DRAW];
+		for (int column = 0; column < 4; column++) {
+			texels[column] = model[column];
+			texels[4 + column] = normalMatrix[column];
+		}
+		return id;
+	}
+
+	unsigned int add(const GeometryAllocation& allocation, const glm::mat4& model)
+	{
+		return add(allocation, 0, allocation.indexCount, model);
+	}
+
+	// draws added so far this frame, the ID the next add() returns
+	unsigned int size() const
+	{
+		return (unsigned int)commands.size();
+	}
+
+	// sends the draw data (and the commands) of the frame in one transfer each
+	void upload()
+	{
+		if (commands.size() > capacity) {
+			while (capacity < commands.size())
+				capacity *= 2;
+			allocate();
+		}
+		if (commands.empty())
+			return;
+
+		// orphan last frame's storage so we never wait for draws still reading it
+		glState.bindBuffer(GL_TEXTURE_BUFFER, dataBuffer);
+		glBufferData(GL_TEXTURE_BUFFER, capacity * TEXELS_PER_DRAW * sizeof(glm::vec4), nullptr, GL_STREAM_DRAW);
+		glBufferSubData(GL_TEXTURE_BUFFER, 0, drawData.size() * sizeof(glm::vec4), drawData.data());
+
+		if (indirectBuffer) {
+			glState.bindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+			glBufferData(GL_DRAW_INDIRECT_BUFFER, capacity * sizeof(DrawElementsIndirectCommand), nullptr, GL_STREAM_DRAW);
+			glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data());
+		}
+	}
+
+	// draws count draws from the ID first with the bound program, a MULTI_DRAW permutation
+	Stats submit(const Shader& shader, unsigned int first, unsigned int count)
+	{
+		Stats stats;
+		if (count == 0)
+			return stats;
+		if (shader.ID != locations.program) {
+			locations.program = shader.ID;
+			locations.drawData = shader.uniformLocation("drawData");
+			locations.drawIdBase = shader.uniformLocation("drawIdBase");
+		}
+		glState.uniform1i(locations.drawData, (int)DRAW_DATA_UNIT);
+		glState.bindTexture(DRAW_DATA_UNIT, GL_TEXTURE_BUFFER, dataTexture);
+
+		unsigned int end = first + count;
+		for (unsigned int start = first; start < end;) {
+			unsigned int run = start + 1;
+			while (run < end && batchKeys[run] == batchKeys[start])
+				run++;
+
+			VertexFormat format = (VertexFormat)(batchKeys[start] >> 1);
+			GLenum indexType = (batchKeys[start] & 1) ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+			geometryArena.bind(format);
+			attachDrawIds(format);
+			glEnableVertexAttribArray(DRAW_ID_LOCATION);
+
+			if (indirectBuffer) {
+				glState.uniform1i(locations.drawIdBase, 0);
+				glState.bindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+				glExt.MultiDrawElementsIndirect(GL_TRIANGLES, indexType, (void*)(start * sizeof(DrawElementsIndirectCommand)),
+					(GLsizei)(run - start), 0);
+				stats.calls++;
+			}
+			else {
+				// aDrawID reads element 0 in a non-instanced draw, the uniform carries the ID
+				size_t indexSize = indexType == GL_UNSIGNED_INT ? sizeof(unsigned int) : sizeof(uint16_t);
+				for (unsigned int i = start; i < run; i++) {
+					const DrawElementsIndirectCommand& command = commands[i];
+					glState.uniform1i(locations.drawIdBase, (int)command.baseInstance);
+					glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)command.count, indexType,
+						(void*)(command.firstIndex * indexSize), command.baseVertex);
+					stats.calls++;
+				}
+			}
+			glDisableVertexAttribArray(DRAW_ID_LOCATION);
+			start = run;
+		}
+		stats.draws = count;
+		return stats;
+	}
+
+	// every draw added this frame
+	Stats submit(const Shader& shader)
+	{
+		return submit(shader, 0, size());
+	}
+
+private:
+	GLuint dataBuffer = 0;
+	GLuint dataTexture = 0;
+	GLuint drawIdBuffer = 0;   // 0, 1, 2 ... capacity - 1
+	GLuint indirectBuffer = 0; // only with glExt.multiDrawIndirect
+	size_t capacity = 0;
+	// arena VAOs that already source aDrawID from drawIdBuffer
+	GLuint attachedVertexArrays[VERTEX_FORMAT_COUNT] = {};
+
+	std::vector<DrawElementsIndirectCommand> commands;
+	std::vector<unsigned int> batchKeys; // format and index type per draw, equal keys share a call
+	std::vector<glm::vec4> drawData;
+
+	struct
+	{
+		unsigned int program = 0;
+		int drawData = -1;
+		int drawIdBase = -1;
+	} locations;
+
+	static unsigned int batchKey(const GeometryAllocation& allocation)
+	{
+		return (unsigned int)allocation.format << 1 | (allocation.indexType == GL_UNSIGNED_INT ? 1u : 0u);
+	}
+
+	// (re)creates the storage for capacity draws
+	void allocate()
+	{
+		glState.bindBuffer(GL_TEXTURE_BUFFER, dataBuffer);
+		glBufferData(GL_TEXTURE_BUFFER, capacity * TEXELS_PER_DRAW * sizeof(glm::vec4), nullptr, GL_STREAM_DRAW);
+		glState.bindTexture(DRAW_DATA_UNIT, GL_TEXTURE_BUFFER, dataTexture);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, dataBuffer);
+
+		std::vector<GLuint> ids(capacity);
+		for (size_t i = 0; i < capacity; i++)
+			ids[i] = (GLuint)i;
+		glState.bindBuffer(GL_ARRAY_BUFFER, drawIdBuffer);
+		// same buffer name, the VAOs pointed at it already read the new storage
+		glBufferData(GL_ARRAY_BUFFER, ids.size() * sizeof(GLuint), ids.data(), GL_STATIC_DRAW);
+	}
+
+	// points the arena VAO of a format (bound by the caller) at the draw IDs, once per VAO
+	void attachDrawIds(VertexFormat format)
+	{
+		GLuint vao = geometryArena.vertexArray(format);
+		if (attachedVertexArrays[format] == vao)
+			return;
+		glState.bindBuffer(GL_ARRAY_BUFFER, drawIdBuffer);
+		glVertexAttribIPointer(DRAW_ID_LOCATION, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+		glVertexAttribDivisor(DRAW_ID_LOCATION, 1);
+		attachedVertexArrays[format] = vao;
+	}
+};
+
+#endif
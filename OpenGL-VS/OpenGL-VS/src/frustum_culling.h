@@ -0,0 +1,389 @@
+#ifndef FRUSTUM_CULLING_H
+#define FRUSTUM_CULLING_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRUSTUM_CULLING_SSE 1
+#include <immintrin.h>
+#endif
+// MSVC defines __AVX__ under /arch:AVX and above, gcc / clang under -mavx
+#if defined(__AVX__)
+#define FRUSTUM_CULLING_AVX 1
+#endif
+
+// Six planes (a, b, c, d) with normalized normals pointing inside: a point p is inside
+// a plane when dot(abc, p) + d >= 0.
+struct Frustum
+{
+	// (windows.h defines NEAR and FAR as macros, hence the suffix)
+	enum { LEFT_PLANE, RIGHT_PLANE, BOTTOM_PLANE, TOP_PLANE, NEAR_PLANE, FAR_PLANE, PLANE_COUNT };
+	glm::vec4 planes[PLANE_COUNT];
+
+	// Gribb / Hartmann extraction from a (projection * view) matrix, planes come out in world space
+	static Frustum fromMatrix(const glm::mat4& viewProjection)
+	{
+		// glm is column major, row i of the matrix is (m[0][i], m[1][i], m[2][i], m[3][i])
+		const glm::mat4& m = viewProjection;
+		glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+		glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+		glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+		glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+		Frustum frustum;
+		frustum.planes[LEFT_PLANE] = row3 + row0;
+		frustum.planes[RIGHT_PLANE] = row3 - row0;
+		frustum.planes[BOTTOM_PLANE] = row3 + row1;
+		frustum.planes[TOP_PLANE] = row3 - row1;
+		frustum.planes[NEAR_PLANE] = row3 + row2;
+		frustum.planes[FAR_PLANE] = row3 - row2;
+		for (glm::vec4& plane : frustum.planes)
+			plane /= glm::length(glm::vec3(plane));
+		return frustum;
+	}
+};
+
+// Bounding spheres in structure-of-arrays form so a kernel loads 4 / 8 objects per register.
+struct SphereBoundsSoA
+{
+	std::vector<float> x, y, z, radius;
+
+	void push(const glm::vec3& center, float r)
+	{
+		x.push_back(center.x);
+		y.push_back(center.y);
+		z.push_back(center.z);
+		radius.push_back(r);
+	}
+
+	std::size_t size() const { return x.size(); }
+
+	void clear()
+	{
+		x.clear();
+		y.clear();
+		z.clear();
+		radius.clear();
+	}
+};
+
+// Axis aligned boxes as center + half extents, same layout idea.
+struct AABBBoundsSoA
+{
+	std::vector<float> centerX, centerY, centerZ;
+	std::vector<float> extentX, extentY, extentZ;
+
+	void push(const glm::vec3& min, const glm::vec3& max)
+	{
+		glm::vec3 center = (min + max) * 0.5f;
+		glm::vec3 extent = (max - min) * 0.5f;
+		centerX.push_back(center.x);
+		centerY.push_back(center.y);
+		centerZ.push_back(center.z);
+		extentX.push_back(extent.x);
+		extentY.push_back(extent.y);
+		extentZ.push_back(extent.z);
+	}
+
+	std::size_t size() const { return centerX.size(); }
+
+	void clear()
+	{
+		centerX.clear();
+		centerY.clear();
+		centerZ.clear();
+		extentX.clear();
+		extentY.clear();
+		extentZ.clear();
+	}
+};
+
+// Visibility kernels. Every kernel writes mask[i] = 1 when object i intersects the frustum and
+// 0 when it is fully outside one plane, and processes [begin, end) so the SIMD kernels can hand
+// their remainder to the scalar one.
+namespace FrustumCulling
+{
+	// ---- scalar reference --------------------------------------------------------
+
+	inline void spheresScalar(const Frustum& frustum, const SphereBoundsSoA& bounds, std::uint8_t* mask, std::size_t begin, std::size_t end)
+	{
+		for (std::size_t i = begin; i < end; i++)
+		{
+			bool visible = true;
+			for (const glm::vec4& plane : frustum.planes)
+			{
+				float distance = plane.x * bounds.x[i] + plane.y * bounds.y[i] + plane.z * bounds.z[i] + plane.w;
+				if (distance < -bounds.radius[i]) {
+					visible = false;
+					break;
+				}
+			}
+			mask[i] = visible ? 1 : 0;
+		}
+	}
+
+	inline void aabbsScalar(const Frustum& frustum, const AABBBoundsSoA& bounds, std::uint8_t* mask, std::size_t begin, std::size_t end)
+	{
+		for (std::size_t i = begin; i < end; i++)
+		{
+			bool visible = true;
+			for (const glm::vec4& plane : frustum.planes)
+			{
+				float distance = plane.x * bounds.centerX[i] + plane.y * bounds.centerY[i] + plane.z * bounds.centerZ[i] + plane.w;
+				// projected half size of the box on the plane normal
+				float reach = std::fabs(plane.x) * bounds.extentX[i] + std::fabs(plane.y) * bounds.extentY[i] + std::fabs(plane.z) * bounds.extentZ[i];
+				if (distance < -reach) {
+					visible = false;
+					break;
+				}
+			}
+			mask[i] = visible ? 1 : 0;
+		}
+	}
+
+#if FRUSTUM_CULLING_SSE
+	// ---- SSE, 4 objects per iteration ------------------------------------------------
+
+	// expands the low 4 bits of a movemask into 4 mask bytes
+	inline void storeMask4(std::uint8_t* mask, int bits)
+	{
+		mask[0] = (std::uint8_t)(bits & 1);
+		mask[1] = (std::uint8_t)((bits >> 1) & 1);
+		mask[2] = (std::uint8_t)((bits >> 2) & 1);
+		mask[3] = (std::uint8_t)((bits >> 3) & 1);
+	}
+
+	inline void spheresSSE(const Frustum& frustum, const SphereBoundsSoA& bounds, std::uint8_t* mask, std::size_t begin, std::size_t end)
+	{
+		std::size_t i = begin;
+		for (; i + 4 <= end; i += 4)
+		{
+			__m128 x = _mm_loadu_ps(&bounds.x[i]);
+			__m128 y = _mm_loadu_ps(&bounds.y[i]);
+			__m128 z = _mm_loadu_ps(&bounds.z[i]);
+			__m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&bounds.radius[i]));
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (const glm::vec4& plane : frustum.planes)
+			{
+				__m128 distance = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)), _mm_mul_ps(y, _mm_set1_ps(plane.y))),
+					_mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+			}
+			storeMask4(mask + i, _mm_movemask_ps(inside));
+		}
+		spheresScalar(frustum, bounds, mask, i, end);
+	}
+
+	inline void aabbsSSE(const Frustum& frustum, const AABBBoundsSoA& bounds, std::uint8_t* mask, std::size_t begin, std::size_t end)
+	{
+		const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+		std::size_t i = begin;
+		for (; i + 4 <= end; i += 4)
+		{
+			__m128 cx = _mm_loadu_ps(&bounds.centerX[i]);
+			__m128 cy = _mm_loadu_ps(&bounds.centerY[i]);
+			__m128 cz = _mm_loadu_ps(&bounds.centerZ[i]);
+			__m128 ex = _mm_loadu_ps(&bounds.extentX[i]);
+			__m128 ey = _mm_loadu_ps(&bounds.extentY[i]);
+			__m128 ez = _mm_loadu_ps(&bounds.extentZ[i]);
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (const glm::vec4& plane : frustum.planes)
+			{
+				__m128 px = _mm_set1_ps(plane.x), py = _mm_set1_ps(plane.y), pz = _mm_set1_ps(plane.z);
+				__m128 distance = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(cx, px), _mm_mul_ps(cy, py)),
+					_mm_add_ps(_mm_mul_ps(cz, pz), _mm_set1_ps(plane.w)));
+				__m128 reach = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(ex, _mm_and_ps(px, signMask)), _mm_mul_ps(ey, _mm_and_ps(py, signMask))),
+					_mm_mul_ps(ez, _mm_and_ps(pz, signMask)));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, reach), _mm_setzero_ps()));
+			}
+			storeMask4(mask + i, _mm_movemask_ps(inside));
+		}
+		aabbsScalar(frustum, bounds, mask, i, end);
+	}
+#endif
+
+#if FRUSTUM_CULLING_AVX
+	// ---- AVX, 8 objects per iteration ------------------------------------------------
+
+	inline void storeMask8(std::uint8_t* mask, int bits)
+	{
+		for (int lane = 0; lane < 8; lane++)
+			mask[lane] = (std::uint8_t)((bits >> lane) & 1);
+	}
+
+	inline void spheresAVX(const Frustum& frustum, const SphereBoundsSoA& bounds, std::uint8_t* mask, std::size_t begin, std::size_t end)
+	{
+		std::size_t i = begin;
+		for (; i + 8 <= end; i += 8)
+		{
+			__m256 x = _mm256_loadu_ps(&bounds.x[i]);
+			__m256 y = _mm256_loadu_ps(&bounds.y[i]);
+			__m256 z = _mm256_loadu_ps(&bounds.z[i]);
+			__m256 negRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&bounds.radius[i]));
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (const glm::vec4& plane : frustum.planes)
+			{
+				__m256 distance = _mm256_add_ps(
+					_mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(plane.x)), _mm256_mul_ps(y, _mm256_set1_ps(plane.y))),
+					_mm256_add_ps(_mm256_mul_ps(z, _mm256_set1_ps(plane.z)), _mm256_set1_ps(plane.w)));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negRadius, _CMP_GE_OQ));
+			}
+			storeMask8(mask + i, _mm256_movemask_ps(inside));
+		}
+		spheresSSE(frustum, bounds, mask, i, end);
+	}
+
+	inline void aabbsAVX(const Frustum& frustum, const AABBBoundsSoA& bounds, std::uint8_t* mask, std::size_t begin, std::size_t end)
+	{
+		const __m256 signMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+		std::size_t i = begin;
+		for (; i + 8 <= end; i += 8)
+		{
+			__m256 cx = _mm256_loadu_ps(&bounds.centerX[i]);
+			__m256 cy = _mm256_loadu_ps(&bounds.centerY[i]);
+			__m256 cz = _mm256_loadu_ps(&bounds.centerZ[i]);
+			__m256 ex = _mm256_loadu_ps(&bounds.extentX[i]);
+			__m256 ey = _mm256_loadu_ps(&bounds.extentY[i]);
+			__m256 ez = _mm256_loadu_ps(&bounds.extentZ[i]);
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (const glm::vec4& plane : frustum.planes)
+			{
+				__m256 px = _mm256_set1_ps(plane.x), py = _mm256_set1_ps(plane.y), pz = _mm256_set1_ps(plane.z);
+				__m256 distance = _mm256_add_ps(
+					_mm256_add_ps(_mm256_mul_ps(cx, px), _mm256_mul_ps(cy, py)),
+					_mm256_add_ps(_mm256_mul_ps(cz, pz), _mm256_set1_ps(plane.w)));
+				__m256 reach = _mm256_add_ps(
+					_mm256_add_ps(_mm256_mul_ps(ex, _mm256_and_ps(px, signMask)), _mm256_mul_ps(ey, _mm256_and_ps(py, signMask))),
+					_mm256_mul_ps(ez, _mm256_and_ps(pz, signMask)));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, reach), _mm256_setzero_ps(), _CMP_GE_OQ));
+			}
+			storeMask8(mask + i, _mm256_movemask_ps(inside));
+		}
+		aabbsSSE(frustum, bounds, mask, i, end);
+	}
+#endif
+
+	// ---- widest kernel this build was compiled for ------------------------------------
+
+	inline const char* kernelName()
+	{
+#if FRUSTUM_CULLING_AVX
+		return "AVX";
+#elif FRUSTUM_CULLING_SSE
+		return "SSE";
+#else
+		return "scalar";
+#endif
+	}
+
+	// mask must hold bounds.size() bytes, returns how many objects are visible
+	inline std::size_t cullSpheres(const Frustum& frustum, const SphereBoundsSoA& bounds, std::uint8_t* mask)
+	{
+#if FRUSTUM_CULLING_AVX
+		spheresAVX(frustum, bounds, mask, 0, bounds.size());
+#elif FRUSTUM_CULLING_SSE
+		spheresSSE(frustum, bounds, mask, 0, bounds.size());
+#else
+		spheresScalar(frustum, bounds, mask, 0, bounds.size());
+#endif
+		std::size_t visible = 0;
+		for (std::size_t i = 0; i < bounds.size(); i++)
+			visible += mask[i];
+		return visible;
+	}
+
+	inline std::size_t cullAABBs(const Frustum& frustum, const AABBBoundsSoA& bounds, std::uint8_t* mask)
+	{
+#if FRUSTUM_CULLING_AVX
+		aabbsAVX(frustum, bounds, mask, 0, bounds.size());
+#elif FRUSTUM_CULLING_SSE
+		aabbsSSE(frustum, bounds, mask, 0, bounds.size());
+#else
+		aabbsScalar(frustum, bounds, mask, 0, bounds.size());
+#endif
+		std::size_t visible = 0;
+		for (std::size_t i = 0; i < bounds.size(); i++)
+			visible += mask[i];
+		return visible;
+	}
+
+	// ---- microbenchmark (--bench-culling) ---------------------------------------------
+
+	// times every kernel compiled in on the same random scene and checks them against the scalar path
+	inline void runBenchmark(std::size_t objectCount = 100000, int iterations = 200)
+	{
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+		std::uniform_real_distribution<float> size(0.1f, 2.0f);
+
+		SphereBoundsSoA spheres;
+		AABBBoundsSoA boxes;
+		for (std::size_t i = 0; i < objectCount; i++)
+		{
+			glm::vec3 center(position(random), position(random), position(random));
+			spheres.push(center, size(random));
+			glm::vec3 extent(size(random), size(random), size(random));
+			boxes.push(center - extent, center + extent);
+		}
+
+		// a camera at the origin looking down -z, the usual 45 degree lens
+		glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+		Frustum frustum = Frustum::fromMatrix(projection);
+
+		std::vector<std::uint8_t> reference(objectCount), mask(objectCount);
+		spheresScalar(frustum, spheres, reference.data(), 0, objectCount);
+		std::vector<std::uint8_t> boxReference(objectCount);
+		aabbsScalar(frustum, boxes, boxReference.data(), 0, objectCount);
+
+		using Kernel = void (*)(const Frustum&, const SphereBoundsSoA&, std::uint8_t*, std::size_t, std::size_t);
+		using BoxKernel = void (*)(const Frustum&, const AABBBoundsSoA&, std::uint8_t*, std::size_t, std::size_t);
+		struct Entry { const char* name; Kernel spheres; BoxKernel boxes; };
+		std::vector<Entry> kernels = { { "scalar", spheresScalar, aabbsScalar } };
+#if FRUSTUM_CULLING_SSE
+		kernels.push_back({ "SSE", spheresSSE, aabbsSSE });
+#endif
+#if FRUSTUM_CULLING_AVX
+		kernels.push_back({ "AVX", spheresAVX, aabbsAVX });
+#endif
+
+		std::size_t visible = 0;
+		for (std::uint8_t v : reference)
+			visible += v;
+		std::cout << "[LOG] > msg : Culling benchmark, " << objectCount << " objects (" << visible << " spheres visible), "
+			<< iterations << " iterations" << std::endl;
+
+		for (const Entry& kernel : kernels)
+		{
+			auto start = std::chrono::steady_clock::now();
+			for (int iteration = 0; iteration < iterations; iteration++)
+				kernel.spheres(frustum, spheres, mask.data(), 0, objectCount);
+			std::chrono::duration<double, std::nano> sphereTime = std::chrono::steady_clock::now() - start;
+			bool sphereMatch = mask == reference;
+
+			start = std::chrono::steady_clock::now();
+			for (int iteration = 0; iteration < iterations; iteration++)
+				kernel.boxes(frustum, boxes, mask.data(), 0, objectCount);
+			std::chrono::duration<double, std::nano> boxTime = std::chrono::steady_clock::now() - start;
+			bool boxMatch = mask == boxReference;
+
+			double perObject = 1.0 / ((double)objectCount * iterations);
+			std::cout << "[LOG] > msg : " << kernel.name
+				<< " spheres " << sphereTime.count() * perObject << " ns/object" << (sphereMatch ? "" : " (MISMATCH)")
+				<< ", aabbs " << boxTime.count() * perObject << " ns/object" << (boxMatch ? "" : " (MISMATCH)") << std::endl;
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,425 @@
+#ifndef GEOMETRY_ARENA_H
+#define GEOMETRY_ARENA_H
+
+#include <glad/glad.h> // include glad to get all the required OpenGL headers
+
+#include "gl_state_cache.h"
+#include "vertex_quantization.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <vector>
+
+// Hands out ranges of [0, capacity) with best fit from a free list and merges neighbouring
+// free ranges back together on free, so the buffer it manages only fragments as far as the
+// live allocations force it to.
+class RangeAllocator
+{
+public:
+	static constexpr size_t INVALID = (size_t)-1;
+
+	struct Stats
+	{
+		size_t capacity = 0;
+		size_t used = 0;
+		size_t allocations = 0;
+		size_t freeBlocks = 0;
+		size_t largestFree = 0;
+
+		// share of the free space that is not in the largest free block, 0 when it is all in one piece
+		float fragmentation() const
+		{
+			size_t free = capacity - used;
+			return free ? 1.0f - (float)largestFree / (float)free : 0.0f;
+		}
+	};
+
+	void reset(size_t newCapacity)
+	{
+		byOffset.clear();
+		bySize.clear();
+		capacity = newCapacity;
+		used = 0;
+		allocations = 0;
+		if (capacity)
+			insertFree(0, capacity);
+	}
+
+	// offset of size units starting on a multiple of alignment, INVALID when nothing fits
+	size_t allocate(size_t size, size_t alignment = 1)
+	{
+		if (size == 0)
+			return INVALID;
+		// smallest block that still fits once its start is aligned
+		for (auto it = bySize.lower_bound(size); it != bySize.end(); ++it) {
+			size_t blockOffset = it->second;
+			size_t blockSize = it->first;
+			size_t offset = (blockOffset + alignment - 1) / alignment * alignment;
+			if (offset + size > blockOffset + blockSize)
+				continue;
+
+			eraseFree(blockOffset);
+			if (offset > blockOffset)
+				insertFree(blockOffset, offset - blockOffset);
+			if (offset + size < blockOffset + blockSize)
+				insertFree(offset + size, blockOffset + blockSize - offset - size);
+			used += size;
+			allocations++;
+			return offset;
+		}
+		return INVALID;
+	}
+
+	void free(size_t offset, size_t size)
+	{
+		if (offset == INVALID || size == 0)
+			return;
+		used -= size;
+		allocations--;
+
+		// merge with the free block right after and right before
+		auto next = byOffset.lower_bound(offset);
+		if (next != byOffset.end() && next->first == offset + size) {
+			size += next->second;
+			eraseFree(next->first);
+		}
+		auto previous = byOffset.lower_bound(offset);
+		if (previous != byOffset.begin()) {
+			--previous;
+			if (previous->first + previous->second == offset) {
+				offset = previous->first;
+				size += previous->second;
+				eraseFree(previous->first);
+			}
+		}
+		insertFree(offset, size);
+	}
+
+	// more room at the end, merged into a trailing free block
+	void grow(size_t newCapacity)
+	{
+		if (newCapacity <= capacity)
+			return;
+		size_t oldCapacity = capacity;
+		capacity = newCapacity;
+		used += newCapacity - oldCapacity; // free() takes it back out
+		allocations++;
+		free(oldCapacity, newCapacity - oldCapacity);
+	}
+
+	size_t getCapacity() const { return capacity; }
+
+	Stats stats() const
+	{
+		Stats result;
+		result.capacity = capacity;
+		result.used = used;
+		result.allocations = allocations;
+		result.freeBlocks = byOffset.size();
+		result.largestFree = bySize.empty() ? 0 : bySize.rbegin()->first;
+		return result;
+	}
+
+private:
+	size_t capacity = 0;
+	size_t used = 0;
+	size_t allocations = 0;
+	std::map<size_t, size_t> byOffset;    // free blocks : offset -> size
+	std::multimap<size_t, size_t> bySize; // free blocks : size -> offset
+
+	void insertFree(size_t offset, size_t size)
+	{
+		byOffset[offset] = size;
+		bySize.emplace(size, offset);
+	}
+
+	void eraseFree(size_t offset)
+	{
+		auto it = byOffset.find(offset);
+		auto range = bySize.equal_range(it->second);
+		for (auto s = range.first; s != range.second; ++s)
+			if (s->second == offset) {
+				bySize.erase(s);
+				break;
+			}
+		byOffset.erase(it);
+	}
+};
+
+// Vertex layouts the arena keeps a buffer and a VAO for
+enum VertexFormat {
+	VERTEX_FORMAT_STANDARD,  // Vertex (mesh.h) and the cube data : vec3 position, vec3 normal, vec2 uv
+	VERTEX_FORMAT_QUANTIZED, // QuantizedVertex (vertex_quantization.h)
+	VERTEX_FORMAT_COUNT
+};
+
+// one mesh's share of the arena
+struct GeometryAllocation {
+	VertexFormat format = VERTEX_FORMAT_STANDARD;
+	size_t vertexOffset = RangeAllocator::INVALID; // in vertices, the base vertex of every draw
+	size_t vertexCount = 0;
+	size_t indexOffset = RangeAllocator::INVALID;  // in bytes
+	size_t indexCount = 0;
+	GLenum indexType = GL_UNSIGNED_INT;
+
+	bool valid() const { return vertexOffset != RangeAllocator::INVALID; }
+	size_t indexSize() const { return indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t); }
+};
+
+// Every static mesh lives in a few big buffers: one vertex buffer (and one VAO) per vertex
+// format, one index buffer shared by all of them. A mesh gets a range of each, its indices
+// stay relative to its first vertex and draws pass that as the base vertex
+// (glDrawElementsBaseVertex). Drawing many meshes of one format needs a single VAO bind.
+// A full buffer is doubled in place (copy to a new buffer), the allocations keep their offsets.
+class GeometryArena
+{
+public:
+	struct Stats
+	{
+		RangeAllocator::Stats vertices[VERTEX_FORMAT_COUNT];
+		RangeAllocator::Stats indices; // in bytes
+	};
+
+	// capacities in vertices per format and index bytes, buffers are created on first use otherwise
+	void create(size_t vertexCapacity = 1 << 16, size_t indexCapacity = 1 << 20)
+	{
+		if (created)
+			return;
+		created = true;
+		initialVertexCapacity = vertexCapacity;
+
+		glGenBuffers(1, &indexBuffer);
+		glState.bindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, indexCapacity, nullptr, GL_STATIC_DRAW);
+		indexRanges.reset(indexCapacity);
+
+		for (int format = 0; format < VERTEX_FORMAT_COUNT; format++) {
+			Pool& pool = pools[format];
+			glGenBuffers(1, &pool.buffer);
+			glState.bindBuffer(GL_COPY_WRITE_BUFFER, pool.buffer);
+			glBufferData(GL_COPY_WRITE_BUFFER, vertexCapacity * stride((VertexFormat)format), nullptr, GL_STATIC_DRAW);
+			pool.ranges.reset(vertexCapacity);
+			glGenVertexArrays(1, &pool.vao);
+			setupVertexArray((VertexFormat)format);
+		}
+	}
+
+	void destroy()
+	{
+		if (!created)
+			return;
+		for (Pool& pool : pools) {
+			glState.forgetVertexArray(pool.vao);
+			glDeleteVertexArrays(1, &pool.vao);
+			glState.forgetBuffer(pool.buffer);
+			glDeleteBuffers(1, &pool.buffer);
+			pool = Pool();
+		}
+		glState.forgetBuffer(indexBuffer);
+		glDeleteBuffers(1, &indexBuffer);
+		indexBuffer = 0;
+		indexRanges.reset(0);
+		created = false;
+	}
+
+	// reserves room for a mesh, growing the buffers when needed
+	GeometryAllocation allocate(VertexFormat format, size_t vertexCount, size_t indexCount, GLenum indexType)
+	{
+		create(initialVertexCapacity);
+
+		GeometryAllocation allocation;
+		allocation.format = format;
+		allocation.vertexCount = vertexCount;
+		allocation.indexCount = indexCount;
+		allocation.indexType = indexType;
+		if (vertexCount == 0 || indexCount == 0)
+			return allocation; // nothing to draw, stays invalid
+
+		Pool& pool = pools[format];
+		allocation.vertexOffset = pool.ranges.allocate(vertexCount);
+		while (allocation.vertexOffset == RangeAllocator::INVALID) {
+			growVertices(format, pool.ranges.getCapacity() + vertexCount);
+			allocation.vertexOffset = pool.ranges.allocate(vertexCount);
+		}
+
+		size_t indexBytes = indexCount * allocation.indexSize();
+		allocation.indexOffset = indexRanges.allocate(indexBytes, sizeof(uint32_t));
+		while (allocation.indexOffset == RangeAllocator::INVALID) {
+			growIndices(indexRanges.getCapacity() + indexBytes);
+			allocation.indexOffset = indexRanges.allocate(indexBytes, sizeof(uint32_t));
+		}
+		return allocation;
+	}
+
+	// vertices in the allocation's format, indices of its type relative to its first vertex
+	void upload(const GeometryAllocation& allocation, const void* vertexData, const void* indexData)
+	{
+		glState.bindBuffer(GL_COPY_WRITE_BUFFER, pools[allocation.format].buffer);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.vertexOffset * stride(allocation.format),
+			allocation.vertexCount * stride(allocation.format), vertexData);
+		glState.bindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.indexOffset, allocation.indexCount * allocation.indexSize(), indexData);
+	}
+
+	void free(GeometryAllocation& allocation)
+	{
+		if (!allocation.valid() || !created) {
+			allocation = GeometryAllocation(); // the whole arena is already gone
+			return;
+		}
+		pools[allocation.format].ranges.free(allocation.vertexOffset, allocation.vertexCount);
+		indexRanges.free(allocation.indexOffset, allocation.indexCount * allocation.indexSize());
+		allocation = GeometryAllocation();
+	}
+
+	// the VAO of a format, with the shared index buffer attached
+	void bind(VertexFormat format)
+	{
+		glState.bindVertexArray(pools[format].vao);
+	}
+
+	// changes with create() / destroy() and never otherwise, growing keeps the VAOs
+	GLuint vertexArray(VertexFormat format) const
+	{
+		return pools[format].vao;
+	}
+
+	// draws indexCount indices from firstIndex of the allocation, its VAO must be bound
+	void draw(const GeometryAllocation& allocation, size_t firstIndex, size_t indexCount) const
+	{
+		glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)indexCount, allocation.indexType,
+			(void*)(allocation.indexOffset + firstIndex * allocation.indexSize()), (GLint)allocation.vertexOffset);
+	}
+
+	void draw(const GeometryAllocation& allocation) const
+	{
+		draw(allocation, 0, allocation.indexCount);
+	}
+
+	// several index ranges of one allocation in one call, offsets in bytes from its first index
+	void multiDraw(const GeometryAllocation& allocation, const GLsizei* counts, const void* const* offsets, size_t drawCount)
+	{
+		drawOffsets.resize(drawCount);
+		baseVertices.assign(drawCount, (GLint)allocation.vertexOffset);
+		for (size_t i = 0; i < drawCount; i++)
+			drawOffsets[i] = (const char*)offsets[i] + allocation.indexOffset;
+		glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts, allocation.indexType, drawOffsets.data(), (GLsizei)drawCount, baseVertices.data());
+	}
+
+	Stats stats() const
+	{
+		Stats result;
+		for (int format = 0; format < VERTEX_FORMAT_COUNT; format++)
+			result.vertices[format] = pools[format].ranges.stats();
+		result.indices = indexRanges.stats();
+		return result;
+	}
+
+	void printStats() const
+	{
+		static const char* names[VERTEX_FORMAT_COUNT] = { "standard", "quantized" };
+		Stats current = stats();
+		for (int format = 0; format < VERTEX_FORMAT_COUNT; format++)
+			printRanges(names[format], "vertices", current.vertices[format]);
+		printRanges("index", "bytes", current.indices);
+	}
+
+	static size_t stride(VertexFormat format)
+	{
+		return format == VERTEX_FORMAT_QUANTIZED ? sizeof(QuantizedVertex) : 8 * sizeof(float);
+	}
+
+private:
+	struct Pool
+	{
+		GLuint buffer = 0;
+		GLuint vao = 0;
+		RangeAllocator ranges; // in vertices
+	};
+
+	bool created = false;
+	size_t initialVertexCapacity = 1 << 16;
+	Pool pools[VERTEX_FORMAT_COUNT];
+	GLuint indexBuffer = 0;
+	RangeAllocator indexRanges;
+	// multiDraw scratch
+	std::vector<const void*> drawOffsets;
+	std::vector<GLint> baseVertices;
+
+	static void printRanges(const char* name, const char* unit, const RangeAllocator::Stats& ranges)
+	{
+		std::cout << "[LOG] > geometry arena : " << name << " " << ranges.used << "/" << ranges.capacity << " " << unit
+			<< ", " << ranges.allocations << " allocations, " << ranges.freeBlocks << " free blocks (largest " << ranges.largestFree
+			<< "), fragmentation " << ranges.fragmentation() * 100.0f << "%" << std::endl;
+	}
+
+	void setupVertexArray(VertexFormat format)
+	{
+		Pool& pool = pools[format];
+		GLsizei size = (GLsizei)stride(format);
+		glState.bindVertexArray(pool.vao);
+		glState.bindBuffer(GL_ARRAY_BUFFER, pool.buffer);
+		glState.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+		if (format == VERTEX_FORMAT_QUANTIZED) {
+			// positions : unorm16, normals : octahedral snorm16, texture coords : half float
+			glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, size, (void*)offsetof(QuantizedVertex, Position));
+			glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, size, (void*)offsetof(QuantizedVertex, Normal));
+			glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, size, (void*)offsetof(QuantizedVertex, TexCoords));
+		}
+		else {
+			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, size, (void*)0);
+			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, size, (void*)(3 * sizeof(float)));
+			glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, size, (void*)(6 * sizeof(float)));
+		}
+		glEnableVertexAttribArray(0);
+		glEnableVertexAttribArray(1);
+		glEnableVertexAttribArray(2);
+	}
+
+	// moves the contents into a new, bigger buffer, offsets stay valid
+	static GLuint regrow(GLuint buffer, size_t oldSize, size_t newSize)
+	{
+		GLuint bigger = 0;
+		glGenBuffers(1, &bigger);
+		glState.bindBuffer(GL_COPY_WRITE_BUFFER, bigger);
+		glBufferData(GL_COPY_WRITE_BUFFER, newSize, nullptr, GL_STATIC_DRAW);
+		glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldSize);
+		glState.forgetBuffer(buffer);
+		glDeleteBuffers(1, &buffer);
+		return bigger;
+	}
+
+	void growVertices(VertexFormat format, size_t atLeast)
+	{
+		Pool& pool = pools[format];
+		size_t capacity = pool.ranges.getCapacity();
+		size_t newCapacity = capacity ? capacity * 2 : atLeast;
+		while (newCapacity < atLeast)
+			newCapacity *= 2;
+		pool.buffer = regrow(pool.buffer, capacity * stride(format), newCapacity * stride(format));
+		pool.ranges.grow(newCapacity);
+		setupVertexArray(format); // the attributes still point at the old buffer
+	}
+
+	void growIndices(size_t atLeast)
+	{
+		size_t capacity = indexRanges.getCapacity();
+		size_t newCapacity = capacity ? capacity * 2 : atLeast;
+		while (newCapacity < atLeast)
+			newCapacity *= 2;
+		indexBuffer = regrow(indexBuffer, capacity, newCapacity);
+		indexRanges.grow(newCapacity);
+		for (int format = 0; format < VERTEX_FORMAT_COUNT; format++) {
+			glState.bindVertexArray(pools[format].vao);
+			glState.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+		}
+	}
+};
+
+// the one arena for the GL context, Mesh and the scene geometry in main.cpp allocate from it
+inline GeometryArena geometryArena;
+
+#endif
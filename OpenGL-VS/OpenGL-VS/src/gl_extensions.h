@@ -0,0 +1,108 @@
+#ifndef GL_EXTENSIONS_H
+#define GL_EXTENSIONS_H
+
+#include <glad/glad.h> // include glad to get all the required OpenGL headers
+
+#include <cstring>
+
+// glad is generated for plain GL 3.3 core, so anything newer is loaded here by hand.
+// Every entry point stays null (and its flag false) when neither the context version
+// nor the extension provides it, callers check the flag before using it.
+
+// GL 4.1 / ARB_get_program_binary
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+// KHR_parallel_shader_compile (ARB_parallel_shader_compile uses the same values)
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// GL 4.3 / ARB_multi_draw_indirect
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+
+struct GLExtensions
+{
+	// GL 4.1 / ARB_get_program_binary
+	bool programBinary = false;
+	void (APIENTRYP GetProgramBinary)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary) = nullptr;
+	void (APIENTRYP ProgramBinary)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length) = nullptr;
+	void (APIENTRYP ProgramParameteri)(GLuint program, GLenum pname, GLint value) = nullptr;
+
+	// KHR_parallel_shader_compile / ARB_parallel_shader_compile
+	// GL_COMPLETION_STATUS_KHR can be polled without waiting for the compiler
+	bool parallelShaderCompile = false;
+	void (APIENTRYP MaxShaderCompilerThreads)(GLuint count) = nullptr;
+
+	// GL 4.3 / ARB_multi_draw_indirect with ARB_base_instance (4.2)
+	// a whole command list in one call, baseInstance carries the draw ID to instanced attributes
+	bool multiDrawIndirect = false;
+	void (APIENTRYP MultiDrawElementsIndirect)(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride) = nullptr;
+};
+
+// filled by loadGLExtensions() right after gladLoadGLLoader()
+inline GLExtensions glExt;
+
+// true when the current context advertises the named extension
+inline bool hasGLExtension(const char* name)
+{
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count; i++)
+	{
+		const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+		if (extension && std::strcmp(extension, name) == 0)
+			return true;
+	}
+	return false;
+}
+
+inline bool hasGLVersion(int major, int minor)
+{
+	return GLVersion.major > major || (GLVersion.major == major && GLVersion.minor >= minor);
+}
+
+inline void loadGLExtensions(GLADloadproc load)
+{
+	// program binaries
+	if (hasGLVersion(4, 1) || hasGLExtension("GL_ARB_get_program_binary"))
+	{
+		glExt.GetProgramBinary = (decltype(glExt.GetProgramBinary))load("glGetProgramBinary");
+		glExt.ProgramBinary = (decltype(glExt.ProgramBinary))load("glProgramBinary");
+		glExt.ProgramParameteri = (decltype(glExt.ProgramParameteri))load("glProgramParameteri");
+
+		GLint formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		glExt.programBinary = glExt.GetProgramBinary && glExt.ProgramBinary && glExt.ProgramParameteri && formats > 0;
+	}
+
+	// background shader compilation
+	if (hasGLExtension("GL_KHR_parallel_shader_compile"))
+		glExt.MaxShaderCompilerThreads = (decltype(glExt.MaxShaderCompilerThreads))load("glMaxShaderCompilerThreadsKHR");
+	else if (hasGLExtension("GL_ARB_parallel_shader_compile"))
+		glExt.MaxShaderCompilerThreads = (decltype(glExt.MaxShaderCompilerThreads))load("glMaxShaderCompilerThreadsARB");
+	if (glExt.MaxShaderCompilerThreads)
+	{
+		// 0xFFFFFFFF lets the driver pick its own thread count
+		glExt.MaxShaderCompilerThreads(0xFFFFFFFFu);
+		glExt.parallelShaderCompile = true;
+	}
+
+	// indirect multi-draw
+	if (hasGLVersion(4, 3) || (hasGLExtension("GL_ARB_multi_draw_indirect") && (hasGLVersion(4, 2) || hasGLExtension("GL_ARB_base_instance"))))
+	{
+		glExt.MultiDrawElementsIndirect = (decltype(glExt.MultiDrawElementsIndirect))load("glMultiDrawElementsIndirect");
+		glExt.multiDrawIndirect = glExt.MultiDrawElementsIndirect != nullptr;
+	}
+}
+
+#endif
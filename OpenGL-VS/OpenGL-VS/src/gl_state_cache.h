@@ -0,0 +1,382 @@
+#ifndef GL_STATE_CACHE_H
+#define GL_STATE_CACHE_H
+
+#include <glad/glad.h> // include glad to get all the required OpenGL headers
+
+#include <cstddef>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+// Shadows the GL state the renderer touches every frame and drops calls that would set
+// a value that is already current: the bound program, VAO, textures per unit, buffer
+// bindings (generic and indexed) and the uniform values of every program.
+// Everything that binds or sets uniforms goes through glState, so the shadow stays exact.
+// Code that changes state behind its back must call invalidate() afterwards.
+class GLStateCache
+{
+public:
+	enum Category { PROGRAM, VERTEX_ARRAY, TEXTURE, BUFFER, UNIFORM, CATEGORY_COUNT };
+
+	// GL calls made and skipped since the last endFrame()
+	struct Stats
+	{
+		unsigned int issued[CATEGORY_COUNT] = {};
+		unsigned int elided[CATEGORY_COUNT] = {};
+
+		unsigned int totalIssued() const
+		{
+			unsigned int total = 0;
+			for (unsigned int count : issued)
+				total += count;
+			return total;
+		}
+
+		unsigned int totalElided() const
+		{
+			unsigned int total = 0;
+			for (unsigned int count : elided)
+				total += count;
+			return total;
+		}
+	};
+
+	GLStateCache()
+	{
+		invalidate();
+	}
+
+	// ---- bindings ------------------------------------------------------------
+
+	void useProgram(GLuint program)
+	{
+		if (program == currentProgram) {
+			stats.elided[PROGRAM]++;
+			return;
+		}
+		glUseProgram(program);
+		stats.issued[PROGRAM]++;
+		currentProgram = program;
+		currentUniforms = program ? &programUniforms[program] : nullptr;
+	}
+
+	// program in use, queried from GL once if the shadow was invalidated
+	GLuint program()
+	{
+		if (currentProgram == UNKNOWN) {
+			GLint current = 0;
+			glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+			currentProgram = (GLuint)current;
+			currentUniforms = currentProgram ? &programUniforms[currentProgram] : nullptr;
+		}
+		return currentProgram;
+	}
+
+	void bindVertexArray(GLuint vao)
+	{
+		if (vao == currentVertexArray) {
+			stats.elided[VERTEX_ARRAY]++;
+			return;
+		}
+		glBindVertexArray(vao);
+		stats.issued[VERTEX_ARRAY]++;
+		currentVertexArray = vao;
+		// the element buffer binding belongs to the VAO
+		bufferBinding(GL_ELEMENT_ARRAY_BUFFER) = UNKNOWN;
+	}
+
+	// binds texture to target on the given unit, switching the active unit only when needed
+	void bindTexture(unsigned int unit, GLenum target, GLuint texture)
+	{
+		int slot = textureSlot(target);
+		if (slot < 0 || unit >= MAX_TEXTURE_UNITS) {
+			// not shadowed, pass it through and forget what we knew about the unit
+			activeTexture(unit);
+			glBindTexture(target, texture);
+			stats.issued[TEXTURE]++;
+			if (unit < MAX_TEXTURE_UNITS)
+				for (GLuint& bound : textures[unit])
+					bound = UNKNOWN;
+			return;
+		}
+		if (textures[unit][slot] == texture) {
+			stats.elided[TEXTURE]++;
+			return;
+		}
+		activeTexture(unit);
+		glBindTexture(target, texture);
+		stats.issued[TEXTURE]++;
+		textures[unit][slot] = texture;
+	}
+
+	void bindBuffer(GLenum target, GLuint buffer)
+	{
+		GLuint& bound = bufferBinding(target);
+		if (bound == buffer) {
+			stats.elided[BUFFER]++;
+			return;
+		}
+		glBindBuffer(target, buffer);
+		stats.issued[BUFFER]++;
+		bound = buffer;
+	}
+
+	void bindBufferBase(GLenum target, GLuint index, GLuint buffer)
+	{
+		bindBufferRange(target, index, buffer, 0, WHOLE_BUFFER);
+	}
+
+	void bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+	{
+		std::vector<IndexedBinding>& bindings = indexedBindings(target);
+		if (index >= bindings.size())
+			bindings.resize(index + 1);
+		IndexedBinding& bound = bindings[index];
+		if (bound.buffer == buffer && bound.offset == offset && bound.size == size) {
+			stats.elided[BUFFER]++;
+			return;
+		}
+		if (size == WHOLE_BUFFER)
+			glBindBufferBase(target, index, buffer);
+		else
+			glBindBufferRange(target, index, buffer, offset, size);
+		stats.issued[BUFFER]++;
+		bound = IndexedBinding{ buffer, offset, size };
+		// indexed binds also replace the generic binding point of the target
+		bufferBinding(target) = buffer;
+	}
+
+	// ---- uniforms of the program in use ----------------------------------------
+
+	void uniform1i(GLint location, GLint value)
+	{
+		if (changed(location, &value, sizeof(value)))
+			glUniform1i(location, value);
+	}
+
+	void uniform1ui(GLint location, GLuint value)
+	{
+		if (changed(location, &value, sizeof(value)))
+			glUniform1ui(location, value);
+	}
+
+	void uniform1f(GLint location, GLfloat value)
+	{
+		if (changed(location, &value, sizeof(value)))
+			glUniform1f(location, value);
+	}
+
+	void uniform2fv(GLint location, const GLfloat* value)
+	{
+		if (changed(location, value, 2 * sizeof(GLfloat)))
+			glUniform2fv(location, 1, value);
+	}
+
+	void uniform3fv(GLint location, const GLfloat* value)
+	{
+		if (changed(location, value, 3 * sizeof(GLfloat)))
+			glUniform3fv(location, 1, value);
+	}
+
+	void uniform4fv(GLint location, const GLfloat* value)
+	{
+		if (changed(location, value, 4 * sizeof(GLfloat)))
+			glUniform4fv(location, 1, value);
+	}
+
+	void uniformMatrix2fv(GLint location, const GLfloat* value)
+	{
+		if (changed(location, value, 4 * sizeof(GLfloat)))
+			glUniformMatrix2fv(location, 1, GL_FALSE, value);
+	}
+
+	void uniformMatrix3fv(GLint location, const GLfloat* value)
+	{
+		if (changed(location, value, 9 * sizeof(GLfloat)))
+			glUniformMatrix3fv(location, 1, GL_FALSE, value);
+	}
+
+	void uniformMatrix4fv(GLint location, const GLfloat* value)
+	{
+		if (changed(location, value, 16 * sizeof(GLfloat)))
+			glUniformMatrix4fv(location, 1, GL_FALSE, value);
+	}
+
+	// ---- object lifetime ---------------------------------------------------------
+
+	// call before a program is deleted or relinked, its uniform values are gone with it
+	void forgetProgram(GLuint program)
+	{
+		programUniforms.erase(program);
+		if (currentProgram == program) {
+			currentProgram = UNKNOWN;
+			currentUniforms = nullptr;
+		}
+	}
+
+	// call when a buffer is deleted, GL unbinds it everywhere and its name may come back
+	void forgetBuffer(GLuint buffer)
+	{
+		for (GLuint& bound : buffers)
+			if (bound == buffer)
+				bound = UNKNOWN;
+		for (std::vector<IndexedBinding>& bindings : indexed)
+			for (IndexedBinding& bound : bindings)
+				if (bound.buffer == buffer)
+					bound = IndexedBinding();
+	}
+
+	void forgetVertexArray(GLuint vao)
+	{
+		if (currentVertexArray == vao)
+			currentVertexArray = UNKNOWN;
+	}
+
+	void forgetTexture(GLuint texture)
+	{
+		for (auto& unit : textures)
+			for (GLuint& bound : unit)
+				if (bound == texture)
+					bound = UNKNOWN;
+	}
+
+	// forget every binding (uniform values stay valid, they live in the programs)
+	void invalidate()
+	{
+		currentProgram = UNKNOWN;
+		currentUniforms = nullptr;
+		currentVertexArray = UNKNOWN;
+		currentTextureUnit = UNKNOWN;
+		for (auto& unit : textures)
+			for (GLuint& bound : unit)
+				bound = UNKNOWN;
+		for (GLuint& bound : buffers)
+			bound = UNKNOWN;
+		for (std::vector<IndexedBinding>& bindings : indexed)
+			bindings.clear();
+	}
+
+	// ---- statistics ----------------------------------------------------------------
+
+	// returns the counters of the frame that just ended and starts a new one
+	Stats endFrame()
+	{
+		Stats frame = stats;
+		stats = Stats();
+		return frame;
+	}
+
+	static const char* categoryName(int category)
+	{
+		static const char* names[CATEGORY_COUNT] = { "program", "vao", "texture", "buffer", "uniform" };
+		return names[category];
+	}
+
+private:
+	static constexpr GLuint UNKNOWN = 0xFFFFFFFFu;
+	static constexpr GLsizeiptr WHOLE_BUFFER = -1;
+	static constexpr unsigned int MAX_TEXTURE_UNITS = 32;
+	static constexpr int TEXTURE_TARGETS = 5;
+	static constexpr int BUFFER_TARGETS = 5;
+
+	struct IndexedBinding
+	{
+		GLuint buffer = UNKNOWN;
+		GLintptr offset = 0;
+		GLsizeiptr size = 0;
+	};
+
+	// last value written to one uniform location, size 0 while unknown
+	struct UniformValue
+	{
+		std::size_t size = 0;
+		alignas(4) unsigned char data[16 * sizeof(GLfloat)];
+	};
+
+	GLuint currentProgram = UNKNOWN;
+	GLuint currentVertexArray = UNKNOWN;
+	GLuint currentTextureUnit = UNKNOWN;
+	GLuint textures[MAX_TEXTURE_UNITS][TEXTURE_TARGETS];
+	GLuint buffers[BUFFER_TARGETS];
+	// indexed binding points, GL_UNIFORM_BUFFER only for now
+	std::vector<IndexedBinding> indexed[1];
+	// a binding point nobody shadows, its value is never trusted
+	GLuint untracked = UNKNOWN;
+
+	// uniform values per program, indexed by location
+	std::unordered_map<GLuint, std::vector<UniformValue>> programUniforms;
+	std::vector<UniformValue>* currentUniforms = nullptr;
+
+	Stats stats;
+
+	void activeTexture(unsigned int unit)
+	{
+		if (unit == currentTextureUnit)
+			return;
+		glActiveTexture(GL_TEXTURE0 + unit);
+		currentTextureUnit = unit;
+	}
+
+	static int textureSlot(GLenum target)
+	{
+		switch (target) {
+		case GL_TEXTURE_2D: return 0;
+		case GL_TEXTURE_CUBE_MAP: return 1;
+		case GL_TEXTURE_2D_ARRAY: return 2;
+		case GL_TEXTURE_3D: return 3;
+		case GL_TEXTURE_BUFFER: return 4;
+		default: return -1;
+		}
+	}
+
+	GLuint& bufferBinding(GLenum target)
+	{
+		switch (target) {
+		case GL_ARRAY_BUFFER: return buffers[0];
+		case GL_ELEMENT_ARRAY_BUFFER: return buffers[1];
+		case GL_UNIFORM_BUFFER: return buffers[2];
+		case GL_PIXEL_UNPACK_BUFFER: return buffers[3];
+		case GL_COPY_WRITE_BUFFER: return buffers[4];
+		default:
+			untracked = UNKNOWN;
+			return untracked;
+		}
+	}
+
+	std::vector<IndexedBinding>& indexedBindings(GLenum target)
+	{
+		(void)target; // only GL_UNIFORM_BUFFER is bound by index in this renderer
+		return indexed[0];
+	}
+
+	// compares against the shadow of the current program and records the new value,
+	// false when the call can be skipped
+	bool changed(GLint location, const void* value, std::size_t size)
+	{
+		if (location < 0)
+			return false; // glUniform* ignores location -1 anyway
+		if (currentProgram == UNKNOWN)
+			program();
+		if (!currentUniforms) {
+			stats.issued[UNIFORM]++;
+			return true;
+		}
+		std::vector<UniformValue>& values = *currentUniforms;
+		if ((std::size_t)location >= values.size())
+			values.resize((std::size_t)location + 1);
+		UniformValue& shadow = values[location];
+		if (shadow.size == size && std::memcmp(shadow.data, value, size) == 0) {
+			stats.elided[UNIFORM]++;
+			return false;
+		}
+		shadow.size = size;
+		std::memcpy(shadow.data, value, size);
+		stats.issued[UNIFORM]++;
+		return true;
+	}
+};
+
+// the one cache for the GL context, used by Shader and the render loop
+inline GLStateCache glState;
+
+#endif
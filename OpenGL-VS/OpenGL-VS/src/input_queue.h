@@ -0,0 +1,160 @@
+#ifndef INPUT_QUEUE_H
+#define INPUT_QUEUE_H
+
+#include <GLFW/glfw3.h>
+
+#include <atomic>
+#include <cstddef>
+
+// One raw input event as delivered by a GLFW callback.
+struct InputEvent
+{
+	enum Type { KEY, CURSOR, SCROLL };
+	Type type = KEY;
+	int key = 0;      // KEY : GLFW key code
+	int action = 0;   // KEY : GLFW_PRESS / GLFW_RELEASE / GLFW_REPEAT
+	double x = 0.0;   // CURSOR : position, SCROLL : offset
+	double y = 0.0;
+};
+
+// Bounded single producer / single consumer ring buffer. push() and pop() never lock:
+// the producer only writes tail, the consumer only writes head, and each publishes its
+// slot with a release store the other side reads with acquire.
+template <typename T, std::size_t Capacity>
+class SpscQueue
+{
+	static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+	// producer side, false (and the event is dropped) when the consumer fell a full ring behind
+	bool push(const T& value)
+	{
+		const std::size_t tail = tailIndex.load(std::memory_order_relaxed);
+		if (tail - headIndex.load(std::memory_order_acquire) == Capacity)
+			return false;
+		slots[tail & (Capacity - 1)] = value;
+		tailIndex.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// consumer side
+	bool pop(T& value)
+	{
+		const std::size_t head = headIndex.load(std::memory_order_relaxed);
+		if (head == tailIndex.load(std::memory_order_acquire))
+			return false;
+		value = slots[head & (Capacity - 1)];
+		headIndex.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	T slots[Capacity];
+	// on separate cache lines so producer and consumer do not false-share
+	alignas(64) std::atomic<std::size_t> headIndex{ 0 };
+	alignas(64) std::atomic<std::size_t> tailIndex{ 0 };
+};
+
+// What the simulation sees of the input for one tick: held keys plus everything that
+// accumulated since the previous drain (mouse motion, scroll), however many raw events it took.
+struct InputState
+{
+	bool keys[GLFW_KEY_LAST + 1] = {};
+	float mouseDeltaX = 0.0f;
+	float mouseDeltaY = 0.0f;   // positive up, GLFW y grows downwards
+	float scroll = 0.0f;
+
+	bool isDown(int key) const
+	{
+		return key >= 0 && key <= GLFW_KEY_LAST && keys[key];
+	}
+};
+
+// GLFW callbacks push raw events, the fixed step simulation drains them once per tick.
+class InputQueue
+{
+public:
+	// events lost because the queue was full
+	unsigned int dropped = 0;
+
+	// ---- producer : GLFW callbacks --------------------------------------------------
+
+	void pushKey(int key, int action)
+	{
+		InputEvent event;
+		event.type = InputEvent::KEY;
+		event.key = key;
+		event.action = action;
+		push(event);
+	}
+
+	void pushCursor(double x, double y)
+	{
+		InputEvent event;
+		event.type = InputEvent::CURSOR;
+		event.x = x;
+		event.y = y;
+		push(event);
+	}
+
+	void pushScroll(double xoffset, double yoffset)
+	{
+		InputEvent event;
+		event.type = InputEvent::SCROLL;
+		event.x = xoffset;
+		event.y = yoffset;
+		push(event);
+	}
+
+	// ---- consumer : simulation tick ---------------------------------------------------
+
+	// applies every queued event to state. Key state persists between ticks, the
+	// accumulated deltas start from zero each time.
+	void drain(InputState& state)
+	{
+		state.mouseDeltaX = 0.0f;
+		state.mouseDeltaY = 0.0f;
+		state.scroll = 0.0f;
+
+		InputEvent event;
+		while (events.pop(event))
+		{
+			switch (event.type)
+			{
+			case InputEvent::KEY:
+				if (event.key >= 0 && event.key <= GLFW_KEY_LAST && event.action != GLFW_REPEAT)
+					state.keys[event.key] = event.action == GLFW_PRESS;
+				break;
+			case InputEvent::CURSOR:
+				// the first position only anchors the deltas
+				if (hasCursor) {
+					state.mouseDeltaX += (float)(event.x - cursorX);
+					state.mouseDeltaY += (float)(cursorY - event.y);
+				}
+				cursorX = event.x;
+				cursorY = event.y;
+				hasCursor = true;
+				break;
+			case InputEvent::SCROLL:
+				state.scroll += (float)event.y;
+				break;
+			}
+		}
+	}
+
+private:
+	SpscQueue<InputEvent, 1024> events;
+
+	// consumer only
+	bool hasCursor = false;
+	double cursorX = 0.0;
+	double cursorY = 0.0;
+
+	void push(const InputEvent& event)
+	{
+		if (!events.push(event))
+			dropped++;
+	}
+};
+
+#endif
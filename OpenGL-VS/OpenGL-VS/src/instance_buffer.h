@@ -0,0 +1,134 @@
+#ifndef INSTANCE_BUFFER_H
+#define INSTANCE_BUFFER_H
+
+#include <glad/glad.h> // include glad to get all the required OpenGL headers
+
+#include <glm/glm.hpp>
+
+#include "gl_state_cache.h"
+#include "geometry_arena.h"
+
+#include <cstddef>
+#include <vector>
+
+// Per-instance attributes of the INSTANCED shader permutation (aModel, aNormalMatrix)
+struct InstanceData
+{
+	glm::mat4 model;
+	glm::mat3 normalMatrix; // transpose(inverse(model)), computed on the CPU
+
+	static InstanceData fromModel(const glm::mat4& model)
+	{
+		InstanceData instance;
+		instance.model = model;
+		instance.normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+		return instance;
+	}
+};
+
+static_assert(sizeof(InstanceData) == 100, "InstanceData must be tightly packed floats");
+
+// Model / normal matrices of many copies of one geometry, streamed into a vertex buffer read
+// with a divisor of 1, so a whole field of objects is a single glDrawElementsInstancedBaseVertex.
+// The instances of several draws share the buffer, draw() points the attributes at the first
+// instance of its range (GL 3.3 has no base instance). The arena VAOs are shared with every
+// other draw, the attributes are only enabled while an instanced draw reads them.
+class InstanceBuffer
+{
+public:
+	// aModel takes four locations, aNormalMatrix three
+	static const unsigned int MODEL_LOCATION = 4;
+	static const unsigned int NORMAL_MATRIX_LOCATION = 8;
+
+	void create(unsigned int initialCapacity)
+	{
+		capacity = initialCapacity > 0 ? initialCapacity : 1;
+		instances.reserve(capacity);
+		glGenBuffers(1, &vbo);
+		glState.bindBuffer(GL_ARRAY_BUFFER, vbo);
+		glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(InstanceData), nullptr, GL_STREAM_DRAW);
+	}
+
+	void destroy()
+	{
+		glState.forgetBuffer(vbo);
+		glDeleteBuffers(1, &vbo);
+		vbo = 0;
+	}
+
+	// starts a new set of instances
+	void begin()
+	{
+		instances.clear();
+	}
+
+	// appends one instance and returns its index
+	unsigned int push(const InstanceData& instance)
+	{
+		instances.push_back(instance);
+		return (unsigned int)instances.size() - 1;
+	}
+
+	unsigned int push(const glm::mat4& model)
+	{
+		return push(InstanceData::fromModel(model));
+	}
+
+	// instances pushed since begin(), the index the next push() returns
+	unsigned int size() const
+	{
+		return (unsigned int)instances.size();
+	}
+
+	// sends every instance in one transfer, only needed when they changed
+	void upload()
+	{
+		while (capacity < instances.size())
+			capacity *= 2;
+		glState.bindBuffer(GL_ARRAY_BUFFER, vbo);
+		// orphan the old storage so we never wait for draws still reading it
+		glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(InstanceData), nullptr, GL_STREAM_DRAW);
+		if (!instances.empty())
+			glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(InstanceData), instances.data());
+	}
+
+	// draws count instances of the allocation from instance first with the bound program,
+	// an INSTANCED permutation
+	void draw(const GeometryAllocation& allocation, unsigned int first, unsigned int count)
+	{
+		if (count == 0 || !allocation.valid())
+			return;
+		geometryArena.bind(allocation.format);
+		glState.bindBuffer(GL_ARRAY_BUFFER, vbo);
+
+		const GLsizei stride = sizeof(InstanceData);
+		size_t base = (size_t)first * sizeof(InstanceData);
+		for (unsigned int column = 0; column < 4; column++) {
+			GLuint location = MODEL_LOCATION + column;
+			glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, stride,
+				(void*)(base + offsetof(InstanceData, model) + column * sizeof(glm::vec4)));
+			glVertexAttribDivisor(location, 1);
+			glEnableVertexAttribArray(location);
+		}
+		for (unsigned int column = 0; column < 3; column++) {
+			GLuint location = NORMAL_MATRIX_LOCATION + column;
+			glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, stride,
+				(void*)(base + offsetof(InstanceData, normalMatrix) + column * sizeof(glm::vec3)));
+			glVertexAttribDivisor(location, 1);
+			glEnableVertexAttribArray(location);
+		}
+
+		glDrawElementsInstancedBaseVertex(GL_TRIANGLES, (GLsizei)allocation.indexCount, allocation.indexType,
+			(void*)allocation.indexOffset, (GLsizei)count, (GLint)allocation.vertexOffset);
+
+		for (GLuint location = MODEL_LOCATION; location < NORMAL_MATRIX_LOCATION + 3; location++)
+			glDisableVertexAttribArray(location);
+	}
+
+private:
+	unsigned int vbo = 0;
+	size_t capacity = 0;
+	std::vector<InstanceData> instances;
+};
+
+#endif
@@ -0,0 +1,145 @@
+#ifndef LIGHT_RIG_H
+#define LIGHT_RIG_H
+
+#include <glad/glad.h> // include glad to get all the required OpenGL headers
+
+#include <glm/glm.hpp>
+
+#include "shaders/shader_s.h"
+#include "shaders/generated/shader_reflection.h"
+
+#include <cstddef>
+#include <cstring>
+
+// Number of point lights in the "Lights" block (MAX_POINT_LIGHTS in shaders/include/lights.glsl)
+const unsigned int MAX_POINT_LIGHTS = 4;
+
+// C++ mirrors of the std140 structs in shaders/include/lights.glsl.
+// A vec3 takes 16 bytes in std140, so every vec3 is followed by a float (data or padding).
+struct DirLightStd140 {
+	glm::vec3 direction; float pad0;
+	glm::vec3 ambient;   float pad1;
+	glm::vec3 diffuse;   float pad2;
+	glm::vec3 specular;  float pad3;
+};
+
+struct PointLightStd140 {
+	glm::vec3 position; float constant;
+	glm::vec3 ambient;  float linear;
+	glm::vec3 diffuse;  float quadratic;
+	glm::vec3 specular; float pad0;
+};
+
+struct SpotLightStd140 {
+	glm::vec3 position;  float cutOff;
+	glm::vec3 direction; float outerCutOff;
+	glm::vec3 ambient;   float constant;
+	glm::vec3 diffuse;   float linear;
+	glm::vec3 specular;  float quadratic;
+};
+
+struct LightBlockStd140 {
+	DirLightStd140 dirLight;
+	PointLightStd140 pointLights[MAX_POINT_LIGHTS];
+	SpotLightStd140 spotLight;
+};
+
+static_assert(sizeof(DirLightStd140) == 64, "DirLight does not match std140");
+static_assert(sizeof(PointLightStd140) == 64, "PointLight does not match std140");
+static_assert(sizeof(SpotLightStd140) == 80, "SpotLight does not match std140");
+static_assert(offsetof(LightBlockStd140, pointLights) == 64, "Lights block does not match std140");
+static_assert(offsetof(LightBlockStd140, spotLight) == 320, "Lights block does not match std140");
+static_assert(sizeof(LightBlockStd140) == 400, "Lights block does not match std140");
+
+// the same layout as reflected from lights.glsl at build time, catches edits to only one side
+using LightsLayout = ShaderReflection::LightsBlock;
+static_assert(sizeof(LightBlockStd140) == LightsLayout::size, "Lights block differs from lights.glsl");
+static_assert(offsetof(LightBlockStd140, pointLights) == LightsLayout::pointLights, "Lights block differs from lights.glsl");
+static_assert(sizeof(PointLightStd140) == LightsLayout::pointLights_stride, "Lights block differs from lights.glsl");
+static_assert(offsetof(LightBlockStd140, spotLight) == LightsLayout::spotLight, "Lights block differs from lights.glsl");
+static_assert(offsetof(DirLightStd140, specular) == LightsLayout::dirLight_specular - LightsLayout::dirLight, "DirLight differs from lights.glsl");
+static_assert(offsetof(PointLightStd140, constant) == LightsLayout::pointLights_constant - LightsLayout::pointLights, "PointLight differs from lights.glsl");
+static_assert(offsetof(PointLightStd140, quadratic) == LightsLayout::pointLights_quadratic - LightsLayout::pointLights, "PointLight differs from lights.glsl");
+static_assert(offsetof(SpotLightStd140, outerCutOff) == LightsLayout::spotLight_outerCutOff - LightsLayout::spotLight, "SpotLight differs from lights.glsl");
+static_assert(offsetof(SpotLightStd140, quadratic) == LightsLayout::spotLight_quadratic - LightsLayout::spotLight, "SpotLight differs from lights.glsl");
+
+// Owns the uniform buffer behind the "Lights" block.
+// Edits go through set(), which records the touched byte range, and upload() sends
+// only that range with one glBufferSubData (nothing at all when nothing changed).
+class LightRig
+{
+public:
+	// binding point shared by every program that lights geometry
+	static const unsigned int BINDING = 0;
+
+	// CPU copy of the block, read freely, write through set()
+	LightBlockStd140 block{};
+
+	void create()
+	{
+		glGenBuffers(1, &ubo);
+		glState.bindBuffer(GL_UNIFORM_BUFFER, ubo);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(LightBlockStd140), &block, GL_DYNAMIC_DRAW);
+		glState.bindBufferBase(GL_UNIFORM_BUFFER, BINDING, ubo);
+		dirtyBegin = dirtyEnd = 0;
+	}
+
+	void destroy()
+	{
+		glState.forgetBuffer(ubo);
+		glDeleteBuffers(1, &ubo);
+		ubo = 0;
+	}
+
+	// connects the program's "Lights" block to the shared binding point
+	void attach(Shader& shader) const
+	{
+		shader.bindUniformBlock("Lights", BINDING);
+	}
+
+	// assigns a member of block and marks its bytes dirty if the value changed
+	template <typename T>
+	void set(T& field, const T& value)
+	{
+		if (std::memcmp(&field, &value, sizeof(T)) == 0)
+			return;
+		field = value;
+		std::size_t offset = (std::size_t)((const char*)&field - (const char*)&block);
+		markDirty(offset, sizeof(T));
+	}
+
+	void markDirty(std::size_t offset, std::size_t size)
+	{
+		if (dirtyBegin == dirtyEnd) {
+			dirtyBegin = offset;
+			dirtyEnd = offset + size;
+			return;
+		}
+		if (offset < dirtyBegin)
+			dirtyBegin = offset;
+		if (offset + size > dirtyEnd)
+			dirtyEnd = offset + size;
+	}
+
+	void markAllDirty()
+	{
+		markDirty(0, sizeof(LightBlockStd140));
+	}
+
+	// sends the dirty range to the GPU
+	void upload()
+	{
+		if (dirtyBegin == dirtyEnd)
+			return;
+		glState.bindBuffer(GL_UNIFORM_BUFFER, ubo);
+		glBufferSubData(GL_UNIFORM_BUFFER, dirtyBegin, dirtyEnd - dirtyBegin, (const char*)&block + dirtyBegin);
+		dirtyBegin = dirtyEnd = 0;
+	}
+
+private:
+	unsigned int ubo = 0;
+	std::size_t dirtyBegin = 0;
+	std::size_t dirtyEnd = 0;
+};
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef LOD_SELECTOR_H
+#define LOD_SELECTOR_H
+
+#include <glm/glm.hpp>
+
+#include "camera.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Picks a level of detail per object from how large its simplification error would appear
+// on screen. Each level carries the object space distance its surface may be off by
+// (MeshSimplifier::Level::error, Mesh::getLods()), projected at the object's distance with
+// the camera's field of view that becomes pixels.
+// A coarser level is only taken once its error is well under the threshold and a finer one
+// as soon as the current level's error goes over it, so an object sitting at a switching
+// distance does not pop back and forth every frame.
+struct LodSelector
+{
+	float pixelThreshold = 1.0f;  // largest error allowed on screen, in pixels
+	float hysteresis = 0.25f;     // coarsening waits until the error is this fraction under the threshold
+	float viewportHeight = 600.0f;
+
+	// pixels an object space length covers at distance (perspective, along the view axis)
+	float projectedPixels(const Camera& camera, float length, float distance) const
+	{
+		float pixelsPerUnit = viewportHeight / (2.0f * std::tan(glm::radians(camera.GetZoom()) * 0.5f));
+		return length * pixelsPerUnit / std::max(distance, 1e-4f);
+	}
+
+	// diameter of a bounding sphere on screen, in pixels
+	float screenSize(const Camera& camera, const glm::vec3& center, float radius) const
+	{
+		return projectedPixels(camera, 2.0f * radius, glm::length(center - camera.GetPosition()));
+	}
+
+	// levels[i].error per level, finest first. center / radius : world space bounding sphere,
+	// errorScale : largest scale of the model matrix. current : the level used last frame.
+	template <typename Levels>
+	int select(const Camera& camera, const glm::vec3& center, float radius, float errorScale, const Levels& levels, int current) const
+	{
+		int count = (int)levels.size();
+		if (count <= 1)
+			return 0;
+		// the nearest point of the object decides, inside the sphere counts as touching the lens
+		float distance = std::max(glm::length(center - camera.GetPosition()) - radius, 1e-4f);
+		auto error = [&](int level) { return projectedPixels(camera, levels[level].error * errorScale, distance); };
+
+		int lod = std::min(std::max(current, 0), count - 1);
+		while (lod > 0 && error(lod) > pixelThreshold)
+			lod--;
+		while (lod + 1 < count && error(lod + 1) <= pixelThreshold * (1.0f - hysteresis))
+			lod++;
+		return lod;
+	}
+};
+
+#endif
@@ -5,13 +5,32 @@
 #include <glad/glad.h> // include glad to get all the required OpenGL headers
 #include <GLFW/glfw3.h>
 #include <functional>
+#include <algorithm>
 #include <cmath>
+#include <chrono>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "include/stb_image.h"
 
+#include "gl_extensions.h"
+#include "gl_state_cache.h"
+#include "geometry_arena.h"
 #include "shaders/shader_s.h"
+#include "shaders/program_cache.h"
+#include "shaders/shader_library.h"
+#include "shaders/shader_hot_reload.h"
+#include "shaders/generated/shader_reflection.h"
 #include "camera.h"
+#include "frustum_culling.h"
+#include "mesh_benchmark.h"
+#include "input_queue.h"
+#include "light_rig.h"
+#include "object_constants.h"
+#include "draw_commands.h"
+#include "instance_buffer.h"
+#include "render_queue.h"
+#include "texture_manager.h"
+#include "texture_streamer.h"
 
 #include <iostream>
 #include <vector>
@@ -45,26 +64,61 @@ const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
 
 // Camera
-Camera camera(glm::vec3(0.0f, 0.0f, 3.0f)); // Initial camera position
-float lastX = SCR_WIDTH / 2.0f; // Last X position of the mouse
-float lastY = SCR_HEIGHT / 2.0f; // Last Y position of the mouse
-bool firstMouse = true; // Flag to check if it's the first mouse input
+// The simulation moves simulationCamera in fixed SIMULATION_STEP ticks, camera is the one used
+// for rendering and sits between the last two simulation states
+Camera simulationCamera(glm::vec3(0.0f, 0.0f, 3.0f)); // Initial camera position
+Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
+CameraState previousCameraState = simulationCamera.GetState();
+const float SIMULATION_STEP = 1.0f / 120.0f;
+float simulationAccumulator = 0.0f; // Simulation time not yet consumed by a tick
+
+// Raw input pushed by the GLFW callbacks, drained once per simulation tick
+InputQueue inputQueue;
+InputState inputState;
 
 float deltaTime = 0.0f; // Time between current frame and last framezz
 float lastFrame = 0.0f; // Time of last frame
+float stateStatsTime = 0.0f; // Time the GL state counters were last logged
 
 // sotres how much we're seeing of either texture (naming Teuxter ID) refectoring should be done frequently depending on the situation
 unsigned int diffuseMap, specularMap;
 
+// Every texture loaded from a file, shared by path and reference counted
+TextureManager textureManager;
+
+// Decodes textures on worker threads and uploads them a few ms per frame, a placeholder texel
+// stands in until then (--sync-textures loads them before the first frame instead)
+TextureStreamer textureStreamer;
+bool streamTextures = true;
+const double TEXTURE_UPLOAD_BUDGET_MS = 2.0;
+std::chrono::steady_clock::time_point textureStreamStart;
+
 // Global variables for OpenGL objects
 GLFWwindow* window = nullptr;
 Shader* lightingShader = nullptr;
 Shader* lightCubeShader = nullptr;
 
-unsigned int cubeVAO = 0;
-unsigned int lightCubeVAO = 0;
+// Typed uniform accessors generated from the GLSL sources (tools/gen_shader_reflection.py)
+ShaderReflection::BasicLighting lightingUniforms;
+ShaderReflection::LightCube lightCubeUniforms;
+
+// Linked program binaries survive between runs in this directory (relative to the working directory)
+ProgramBinaryCache programCache("shader_cache");
+
+// Every program permutation is built once and owned by the library
+ShaderLibrary shaderLibrary;
+
+// Rebuilds programs in the background when their source files change
+ShaderHotReloader shaderHotReloader;
+
+// Programs are compiled asynchronously, the scene is drawn once all of them are ready
+bool shadersReady = false;
+std::chrono::steady_clock::time_point shaderBuildStart;
+
+// one vertex and index range of the geometry arena, shared by the cubes and the light cubes
+GeometryAllocation cubeGeometry;
 
-glm::vec3 cubePositions[] = {
+std::vector<glm::vec3> cubePositions = {
     glm::vec3(0.0f,  0.0f,  0.0f),
     glm::vec3(2.0f,  5.0f, -15.0f),
     glm::vec3(-1.5f, -2.2f, -2.5f),
@@ -77,6 +131,45 @@ glm::vec3 cubePositions[] = {
     glm::vec3(-1.3f,  1.0f, -1.5f)
 };
 
+// Directional, point and spot lights, uploaded as one uniform buffer
+LightRig lightRig;
+
+// --cubes N : N more cubes on a grid behind the ten above
+unsigned int cubeFieldCount = 0;
+// --multi-draw : submit the cubes through the indirect multi-draw builder instead of instancing
+bool useMultiDraw = false;
+
+// Model / normal matrices of the cubes and light cubes, they never move so they are computed once
+std::vector<InstanceData> cubeInstances;
+std::vector<InstanceData> lightCubeInstances;
+
+// Every visible object under a sort key (pass, program, material, vao, depth), its payload is
+// the object index : the cubes, then the light cubes. Rebuilt only when the culling masks change
+RenderQueue renderQueue;
+bool instancesDirty = true;
+// what the queue's draw order costs in state switches before and after sorting
+RenderQueue::StateChanges unsortedStateChanges;
+RenderQueue::StateChanges sortedStateChanges;
+
+// Small IDs of the sort key fields
+enum SceneProgram { PROGRAM_LIGHTING, PROGRAM_LIGHT_CUBE };
+enum SceneMaterial { MATERIAL_CONTAINER, MATERIAL_NONE };
+
+// The visible objects in queue order, one instanced draw per run
+InstanceBuffer instanceBuffer;
+
+// --multi-draw : the visible objects in queue order with their model / normal matrix,
+// one multi-draw per run
+DrawCommandBuilder drawCommands;
+
+// Bounding spheres of the cubes / light cubes and their per-frame visibility (1 = inside the frustum)
+SphereBoundsSoA cubeBounds;
+SphereBoundsSoA lightCubeBounds;
+std::vector<std::uint8_t> cubeVisible;
+std::vector<std::uint8_t> lightCubeVisible;
+// camera version the masks were computed for
+unsigned int culledCameraVersion = 0;
+
 // positions of the point lights
 glm::vec3 pointLightPositions[] = {
     glm::vec3(0.7f,  0.2f,  2.0f),
@@ -85,8 +178,6 @@ glm::vec3 pointLightPositions[] = {
     glm::vec3(0.0f,  0.0f, -3.0f)
 };
 
-// Model matrix
-glm::mat4 model = glm::mat4(1.0f);
 // view matrix
 glm::mat4 view = glm::mat4(1.0f);
 // projection matrix
@@ -113,19 +204,27 @@ bool draw();
 void mainLoop();
 void cleanup();
 
-void processInput(GLFWwindow* window);
+void buildRenderQueue();
+Shader* bindSceneProgram(unsigned int program);
+void bindSceneMaterial(unsigned int material);
+
+void simulationTick(float step);
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xposIn, double yposIn);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 
-void setModel(Shader* shader);
-void setProjection(Shader* shader);
-void setCameraTransform(Shader* shader);
+void setProjection(const UniformField<glm::mat4>& field);
+void setCameraTransform(const UniformField<glm::mat4>& field);
 
 // Function declarations for shader compilation and setup
-bool setupShaderUnified(Shader*& shaderPtr, const char* vertexPath, const char* fragmentPath, const std::string& shaderName);
+bool setupShaderUnified(Shader*& shaderPtr, const char* vertexPath, const char* fragmentPath, const std::string& shaderName, const ShaderDefines& defines = ShaderDefines());
 bool setupAllShaders();
 bool setupVertexData();
+bool setupObjectBuffers();
+bool setupLights();
+bool setupCubeField();
+bool setupBounds();
 
 unsigned int loadTexture(char const * path);
 
@@ -143,40 +242,42 @@ auto loggingDecorator(Func func, const std::string& funcName, Args... args) {
     return result;
 }
 
-void setModel(Shader* shader) {
-    if (!shader) {
-        cout << "[Err] > msg : Shader is null in setModel" << endl;
-        return;
-    }
-    // Set the model matrix to identity (no transformations)
-    model = glm::mat4(1.0f);
-    shader->setMat4("model", model);
-}
-
-
 // Function to set the projection matrix
-void setProjection(Shader* shader) {
-    if(!shader) {
-        cout << "[Err] > msg : Shader is null in setProjection" << endl;
-        return;
-	}
-
-	// Set the projection matrix to a perspective projection
-	projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-    shader->setMat4("projection", projection);
+void setProjection(const UniformField<glm::mat4>& field) {
+	// Set the projection matrix to a perspective projection (cached by the camera, rebuilt only after a zoom or resize)
+	projection = camera.GetProjectionMatrix();
+    field.set(projection);
 }
 
-void setCameraTransform(Shader* shader) {
-    if (!shader) {
-        cout << "[Err] > msg : Shader is null in setCameraTransform" << endl;
-        return;
-	}
+void setCameraTransform(const UniformField<glm::mat4>& field) {
     // Set the camera transformation matrix
 	view = camera.GetViewMatrix();
-    shader->setMat4("view", view);
+    field.set(view);
 }
 
-int main() {
+int main(int argc, char** argv) {
+
+    // --bench-culling : time the culling kernels against each other and exit, no window needed
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--bench-culling") {
+            FrustumCulling::runBenchmark();
+            return 0;
+        }
+        // --bench-mesh : run the mesh optimize / quantize / LOD / meshlet stages on a generated grid and exit
+        if (std::string(argv[i]) == "--bench-mesh") {
+            MeshBenchmark::run();
+            return 0;
+        }
+        // --cubes N : a bigger cube field, one instanced draw whatever its size
+        if (std::string(argv[i]) == "--cubes" && i + 1 < argc)
+            cubeFieldCount = (unsigned int)std::stoul(argv[++i]);
+        // --multi-draw : one indirect command per cube instead of instancing
+        if (std::string(argv[i]) == "--multi-draw")
+            useMultiDraw = true;
+        // --sync-textures : decode and upload every texture inside draw(), the old blocking path
+        if (std::string(argv[i]) == "--sync-textures")
+            streamTextures = false;
+    }
 
     // Initialization
     if (!loggingDecorator(init, "init")) {
@@ -219,9 +320,11 @@ bool init() {
 
     // Make the window's context current
     glfwMakeContextCurrent(window);
+    camera.SetAspect((float)SCR_WIDTH / (float)SCR_HEIGHT);
 
     // Set callback functions
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+	glfwSetKeyCallback(window, key_callback);
 	glfwSetCursorPosCallback(window, mouse_callback);
 	glfwSetScrollCallback(window, scroll_callback);
 
@@ -230,6 +333,10 @@ bool init() {
         return false;
     }
 
+    // Load the post-3.3 entry points we use when the driver has them
+    loadGLExtensions((GLADloadproc)glfwGetProcAddress);
+    cout << "[LOG] > msg : Program binary cache " << (programCache.enabled() ? "enabled" : "unsupported by driver") << endl;
+
     return true;
 }
 
@@ -246,7 +353,32 @@ bool draw() {
         return false;
     }
 
+    // Setup Per-Object Buffers
+    if (!loggingDecorator(setupObjectBuffers, "setupObjectBuffers")) {
+        return false;
+    }
+
+    // Setup Light Data
+    if (!loggingDecorator(setupLights, "setupLights")) {
+        return false;
+    }
+
+    // Setup Cube Transforms
+    if (!loggingDecorator(setupCubeField, "setupCubeField")) {
+        return false;
+    }
+
+    // Setup Culling Data
+    if (!loggingDecorator(setupBounds, "setupBounds")) {
+        return false;
+    }
+
     // Setup Texture Data
+    if (streamTextures) {
+        textureStreamStart = std::chrono::steady_clock::now();
+        textureStreamer.start();
+        textureManager.streamer = &textureStreamer;
+    }
     diffuseMap = loggingDecorator(loadTexture, "loadTexture", texturePath);
     if (!diffuseMap) {
         return false;
@@ -256,26 +388,17 @@ bool draw() {
     if (!specularMap) {
         return false;
 	}
-
-	lightingShader->use();
-	lightingShader->setInt("material.diffuse", 0); // Set the diffuse map to texture unit 0
-	lightingShader->setInt("material.specular", 1); // Set the specular map to texture unit 0
+    textureManager.printStats();
 
     return true;
 }
 
 // Setup Shader
-bool setupShaderUnified(Shader*& shaderPtr, const char* vertexPath, const char* fragmentPath, const std::string& shaderName){
+bool setupShaderUnified(Shader*& shaderPtr, const char* vertexPath, const char* fragmentPath, const std::string& shaderName, const ShaderDefines& defines){
 
     try {
-		// If shader already exists, delete it
-        if (shaderPtr) {
-            delete shaderPtr;
-            shaderPtr = nullptr;
-        }
-
-		// Create a shader using shader class
-        shaderPtr = new Shader(vertexPath, fragmentPath);
+		// Get the permutation from the library, it is only compiled the first time it is asked for
+        shaderPtr = shaderLibrary.get(vertexPath, fragmentPath, defines);
         cout << "[LOG] > msg : " << shaderName << " shader setup successful" << endl;
         return true;
     }
@@ -287,21 +410,57 @@ bool setupShaderUnified(Shader*& shaderPtr, const char* vertexPath, const char*
 
 bool setupAllShaders() {
     bool success = true;
+    shaderBuildStart = std::chrono::steady_clock::now();
+    unsigned int hitsBefore = programCache.hits;
+    unsigned int missesBefore = programCache.misses;
+
+    shaderLibrary.baseOptions.cache = &programCache;
+    shaderLibrary.baseOptions.async = true;
+
+    // Lighting permutation : every point light of the rig, the flashlight and a specular map
+    ShaderDefines lightingDefines;
+    lightingDefines.set("NR_POINT_LIGHTS", (int)MAX_POINT_LIGHTS);
+    lightingDefines.set("USE_SPOTLIGHT", 1);
+    lightingDefines.set("HAS_SPECULAR_MAP", 1);
+    // transforms from the instance buffer, or fetched by draw ID with --multi-draw
+    lightingDefines.set(useMultiDraw ? "MULTI_DRAW" : "INSTANCED", 1);
+
+    // LightCube permutation : transforms from the same source as the cubes
+    ShaderDefines lightCubeDefines;
+    lightCubeDefines.set(useMultiDraw ? "MULTI_DRAW" : "INSTANCED", 1);
 
     // Lighting ̴ 
     if (!loggingDecorator([&]() {
-        return setupShaderUnified(lightingShader, lightVertexShaderPath, lightFragmentShaderPath, "Lighting");
+        return setupShaderUnified(lightingShader, lightVertexShaderPath, lightFragmentShaderPath, "Lighting", lightingDefines);
         }, "setupLightingShader")) {
         success = false;
     }
 
     // LightCube ̴ 
     if (!loggingDecorator([&]() {
-        return setupShaderUnified(lightCubeShader, lightCubeVertexShaderPath, lightCubeFragmentShaderPath, "LightCube");
+        return setupShaderUnified(lightCubeShader, lightCubeVertexShaderPath, lightCubeFragmentShaderPath, "LightCube", lightCubeDefines);
         }, "setupLightCubeShader")) {
         success = false;
     }
 
+    if (success) {
+        // samplers are program state, the shader re-applies them after every rebuild
+        lightingShader->bindSampler("material.diffuse", 0); // Set the diffuse map to texture unit 0
+        lightingShader->bindSampler("material.specular", 1); // Set the specular map to texture unit 1
+
+#ifndef EMBED_SHADERS
+        // embedded builds have no sources on disk to watch
+        shaderHotReloader.watch(lightingShader);
+        shaderHotReloader.watch(lightCubeShader);
+        shaderHotReloader.start();
+#endif
+    }
+
+    // Cold (compile + link) vs warm (binary reload) submission cost, compilation may continue in the background
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - shaderBuildStart;
+    cout << "[LOG] > msg : Shaders submitted in " << elapsed.count() << " ms (program cache hits : "
+        << programCache.hits - hitsBefore << ", misses : " << programCache.misses - missesBefore << ")" << endl;
+
     return success;
 }
 
@@ -312,42 +471,8 @@ unsigned int loadTexture(char const* path) {
         return 0;
 	}
 
-
-	unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    // load and generate the texture
-    int width, height, nrChannels;
-    unsigned char* data_container = stbi_load("img/container2.png", &width, &height, &nrChannels, 0);
-
-    if (data_container) {
-        cout << "[LOG] > msg : Texture container2 loaded successfully" << endl;
-
-        GLenum format = 0;
-        if (nrChannels == 1)
-            format = GL_RED;
-        else if (nrChannels == 3)
-            format = GL_RGB;
-        else if (nrChannels == 4)
-			format = GL_RGBA;
-
-		glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data_container);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        // set the texture wrapping parameters//
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    }
-    else {
-        cout << "[Err : Texture] > msg : Failed to load at path : " << path << endl;
-        return 0;
-    }
-    stbi_image_free(data_container);
-
-    return textureID;
+    // decoded and uploaded once per file, asking again for the same image shares the texture
+    return textureManager.acquire(path);
 }
 
 bool setupVertexData() {
@@ -397,49 +522,123 @@ bool setupVertexData() {
         -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f
     };
 
-    unsigned int VBO = 0;
-    unsigned int EBO = 0;
+    // the cube is drawn unindexed, 0..35 lets it share the arena's indexed draws with the meshes
+    unsigned short indices[36];
+    for (unsigned short i = 0; i < 36; i++)
+        indices[i] = i;
 
-    glGenVertexArrays(1, &cubeVAO);
-    if (cubeVAO == 0) {
-        cout << "[Err : VAO ] > msg :  VAO error" << endl;
-        return false;
-    }
+    geometryArena.create();
 
-    glGenBuffers(1, &VBO);
-    if (VBO == 0) {
-        cout << "[Err : VBO ] > msg :  VBO error" << endl;
+    // cubes and light cubes draw the same range through the standard format's VAO, the light
+    // cube shader just reads position only
+    cubeGeometry = geometryArena.allocate(VERTEX_FORMAT_STANDARD, 36, 36, GL_UNSIGNED_SHORT);
+    if (!cubeGeometry.valid()) {
+        cout << "[Err : Geometry ] > msg :  cube allocation error" << endl;
         return false;
     }
+    geometryArena.upload(cubeGeometry, vertices, indices);
+    geometryArena.printStats();
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-    
-    // Vertex attribute
-    glBindVertexArray(cubeVAO);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
+    return true;
+}
 
-	// Light Cube VAO
-	glGenVertexArrays(1, &lightCubeVAO);
-	glBindVertexArray(lightCubeVAO);
+bool setupObjectBuffers() {
+    // Per-object constants for the cubes and light cubes
+    drawCommands.create(16);
 
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	/// Maybe this change to 6 * sizeof(float)
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
+    return true;
+}
 
+bool setupCubeField() {
+    // the extra cubes fill a cube shaped grid behind the tutorial ones
+    const float spacing = 3.0f;
+    unsigned int side = 1;
+    while (side * side * side < cubeFieldCount)
+        side++;
+    for (unsigned int i = 0; i < cubeFieldCount; i++) {
+        unsigned int x = i % side, y = (i / side) % side, z = i / (side * side);
+        cubePositions.push_back(glm::vec3(
+            ((float)x - 0.5f * (float)(side - 1)) * spacing,
+            ((float)y - 0.5f * (float)(side - 1)) * spacing,
+            -20.0f - (float)z * spacing));
+    }
 
-    // Unbind VBO and VAO
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    cubeInstances.clear();
+    for (unsigned int i = 0; i < cubePositions.size(); i++) {
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, cubePositions[i]);
+        float angle = 20.0f * i;
+        model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
+        cubeInstances.push_back(InstanceData::fromModel(model));
+    }
+    lightCubeInstances.clear();
+    for (const glm::vec3& position : pointLightPositions) {
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, position);
+        model = glm::scale(model, glm::vec3(0.2f)); // Make it smaller
+        lightCubeInstances.push_back(InstanceData::fromModel(model));
+    }
 
-    // Delete VBO as it's no longer needed (optional)
-    // glDeleteBuffers(1, &VBO);
+    instanceBuffer.create((unsigned int)(cubeInstances.size() + lightCubeInstances.size()));
+    instancesDirty = true;
+    cout << "[LOG] > msg : " << cubeInstances.size() << " cubes and " << lightCubeInstances.size() << " light cubes, drawn "
+        << (useMultiDraw ? "with indirect multi-draw" : "instanced") << endl;
+    return true;
+}
+
+bool setupBounds() {
+    // the cube spans [-0.5, 0.5] on every axis, its circumscribed sphere holds it under any rotation
+    const float cubeRadius = 0.5f * std::sqrt(3.0f);
+    cubeBounds.clear();
+    for (const glm::vec3& position : cubePositions)
+        cubeBounds.push(position, cubeRadius);
+    lightCubeBounds.clear();
+    for (const glm::vec3& position : pointLightPositions)
+        lightCubeBounds.push(position, cubeRadius * 0.2f); // light cubes are scaled by 0.2
+    cubeVisible.assign(cubeBounds.size(), 1);
+    lightCubeVisible.assign(lightCubeBounds.size(), 1);
+    cout << "[LOG] > msg : Culling " << cubeBounds.size() + lightCubeBounds.size() << " objects with the " << FrustumCulling::kernelName() << " kernel" << endl;
+    return true;
+}
+
+bool setupLights() {
+    /*
+       Every light lives in the std140 "Lights" block of basic_lighting.fs. The values are written once
+       here and uploaded as a whole, afterwards only the spotlight pose is patched per frame.
+    */
+    LightBlockStd140& block = lightRig.block;
+
+    // directional light
+    block.dirLight.direction = glm::vec3(-0.2f, -1.0f, -0.3f);
+    block.dirLight.ambient = glm::vec3(0.05f, 0.05f, 0.05f);
+    block.dirLight.diffuse = glm::vec3(0.4f, 0.4f, 0.4f);
+    block.dirLight.specular = glm::vec3(0.5f, 0.5f, 0.5f);
+
+    // point lights
+    for (unsigned int i = 0; i < MAX_POINT_LIGHTS; i++) {
+        block.pointLights[i].position = pointLightPositions[i];
+        block.pointLights[i].ambient = glm::vec3(0.05f, 0.05f, 0.05f);
+        block.pointLights[i].diffuse = glm::vec3(0.8f, 0.8f, 0.8f);
+        block.pointLights[i].specular = glm::vec3(1.0f, 1.0f, 1.0f);
+        block.pointLights[i].constant = 1.0f;
+        block.pointLights[i].linear = 0.09f;
+        block.pointLights[i].quadratic = 0.032f;
+    }
+
+    // spotLight
+    block.spotLight.position = camera.GetPosition();
+    block.spotLight.direction = camera.GetFront();
+    block.spotLight.ambient = glm::vec3(0.0f, 0.0f, 0.0f);
+    block.spotLight.diffuse = glm::vec3(1.0f, 1.0f, 1.0f);
+    block.spotLight.specular = glm::vec3(1.0f, 1.0f, 1.0f);
+    block.spotLight.constant = 1.0f;
+    block.spotLight.linear = 0.09f;
+    block.spotLight.quadratic = 0.032f;
+    block.spotLight.cutOff = glm::cos(glm::radians(12.5f));
+    block.spotLight.outerCutOff = glm::cos(glm::radians(15.0f));
+
+    lightRig.create();
+    lightRig.attach(*lightingShader);
 
     return true;
 }
@@ -453,8 +652,16 @@ void mainLoop() {
 		deltaTime = currentFrame - lastFrame;   // calculate time difference between current frame and last frame
 		lastFrame = currentFrame;               // set last frame to current frame
         
-        // Input
-        processInput(window);
+        // Fixed step simulation : the input is drained and the camera moved once per tick,
+        // however many raw events arrived and whatever the frame rate
+        simulationAccumulator += std::min(deltaTime, 0.25f); // a long stall must not queue up hundreds of ticks
+        while (simulationAccumulator >= SIMULATION_STEP) {
+            previousCameraState = simulationCamera.GetState();
+            simulationTick(SIMULATION_STEP);
+            simulationAccumulator -= SIMULATION_STEP;
+        }
+        // render between the last two simulation states, the camera only rebuilds its matrices if that moved it
+        camera.SetState(CameraState::Interpolate(previousCameraState, simulationCamera.GetState(), simulationAccumulator / SIMULATION_STEP));
 
 		// Depth
 		glEnable(GL_DEPTH_TEST);
@@ -463,117 +670,80 @@ void mainLoop() {
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		// be sure to activate shader when setting uniforms/drawing objects
-        lightingShader->use();
-		lightingShader->setVec3("viewPos", camera.Position);
-		lightingShader->setFloat("material.shininess", 32.0f);
-
-        /*
-           Here we set all the uniforms for the 5/6 types of lights we have. We have to set them manually and index
-           the proper PointLight struct in the array to set each uniform variable. This can be done more code-friendly
-           by defining light types as classes and set their values in there, or by using a more efficient uniform approach
-           by using 'Uniform buffer objects', but that is something we'll discuss in the 'Advanced GLSL' tutorial.
-        */
-		// directional light
-		lightingShader->setVec3("dirLight.direction", -0.2f, -1.0f, -0.3f);
-		lightingShader->setVec3("dirLight.ambient", 0.05f, 0.05f, 0.05f);
-		lightingShader->setVec3("dirLight.diffuse", 0.4f, 0.4f, 0.4f);
-		lightingShader->setVec3("dirLight.specular", 0.5f, 0.5f, 0.5f);
-
-		// point light 1
-		lightingShader->setVec3("pointLights[0].position", pointLightPositions[0]);
-		lightingShader->setVec3("pointLights[0].ambient", 0.05f, 0.05f, 0.05f);
-		lightingShader->setVec3("pointLights[0].diffuse", 0.8f, 0.8f, 0.8f);
-		lightingShader->setVec3("pointLights[0].specular", 1.0f, 1.0f, 1.0f);
-		lightingShader->setFloat("pointLights[0].constant", 1.0f);
-		lightingShader->setFloat("pointLights[0].linear", 0.09f);
-		lightingShader->setFloat("pointLights[0].quadratic", 0.032f);
-
-		// point light 2
-		lightingShader->setVec3("pointLights[1].position", pointLightPositions[1]);
-		lightingShader->setVec3("pointLights[1].ambient", 0.05f, 0.05f, 0.05f);
-		lightingShader->setVec3("pointLights[1].diffuse", 0.8f, 0.8f, 0.8f);
-		lightingShader->setVec3("pointLights[1].specular", 1.0f, 1.0f, 1.0f);
-		lightingShader->setFloat("pointLights[1].constant", 1.0f);
-		lightingShader->setFloat("pointLights[1].linear", 0.09f);
-		lightingShader->setFloat("pointLights[1].quadratic", 0.032f);
-		
-        // point light 3
-		lightingShader->setVec3("pointLights[2].position", pointLightPositions[2]);
-		lightingShader->setVec3("pointLights[2].ambient", 0.05f, 0.05f, 0.05f);
-		lightingShader->setVec3("pointLights[2].diffuse", 0.8f, 0.8f, 0.8f);
-		lightingShader->setVec3("pointLights[2].specular", 1.0f, 1.0f, 1.0f);
-		lightingShader->setFloat("pointLights[2].constant", 1.0f);
-		lightingShader->setFloat("pointLights[2].linear", 0.09f);
-		lightingShader->setFloat("pointLights[2].quadratic", 0.032f);
-
-		// point light 4
-		lightingShader->setVec3("pointLights[3].position", pointLightPositions[3]);
-		lightingShader->setVec3("pointLights[3].ambient", 0.05f, 0.05f, 0.05f);
-		lightingShader->setVec3("pointLights[3].diffuse", 0.8f, 0.8f, 0.8f);
-		lightingShader->setVec3("pointLights[3].specular", 1.0f, 1.0f, 1.0f);
-		lightingShader->setFloat("pointLights[3].constant", 1.0f);
-		lightingShader->setFloat("pointLights[3].linear", 0.09f);
-		lightingShader->setFloat("pointLights[3].quadratic", 0.032f);
-
-        // spotLight
-		lightingShader->setVec3("spotLight.position", camera.Position);
-		lightingShader->setVec3("spotLight.direction", camera.Front);
-		lightingShader->setVec3("spotLight.ambient", 0.0f, 0.0f, 0.0f);
-		lightingShader->setVec3("spotLight.diffuse", 1.0f, 1.0f, 1.0f);
-		lightingShader->setVec3("spotLight.specular", 1.0f, 1.0f, 1.0f);
-		lightingShader->setFloat("spotLight.constant", 1.0f);
-		lightingShader->setFloat("spotLight.linear", 0.09f);
-		lightingShader->setFloat("spotLight.quadratic", 0.032f);
-		lightingShader->setFloat("spotLight.cutOff", glm::cos(glm::radians(12.5f)));
-		lightingShader->setFloat("spotLight.outerCutOff", glm::cos(glm::radians(15.0f)));
-
-
-        setProjection(lightingShader);
-        setCameraTransform(lightingShader);
-		setModel(lightingShader);
-
-		// Bind diffuse map
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, diffuseMap);
-
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, specularMap);
-
-        // Render the cube
-        glBindVertexArray(cubeVAO);
-        for (unsigned int i = 0; i < 10; i++)
-        {
-            // calculate the model matrix for each object and pass it to shader before drawing
-            glm::mat4 model = glm::mat4(1.0f);
-            model = glm::translate(model, cubePositions[i]);
-            float angle = 20.0f * i;
-            model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-            lightingShader->setMat4("model", model);
-
-            glDrawArrays(GL_TRIANGLES, 0, 36);
+        // Make the textures the workers decoded resident, without going over the frame's budget.
+        // Logged when the last pending one is done, whether it was uploaded or failed to decode.
+        bool wasIdle = textureStreamer.idle();
+        textureStreamer.update(TEXTURE_UPLOAD_BUDGET_MS);
+        if (!wasIdle && textureStreamer.idle()) {
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - textureStreamStart;
+            cout << "[LOG] > msg : Texture streaming finished after " << elapsed.count() << " ms" << endl;
+            textureStreamer.printStats();
         }
 
-        // Render the light cube
-        lightCubeShader->use();
+        // Keep the window responsive while the programs finish compiling
+        if (!shadersReady) {
+            if (!lightingShader->isReady() || !lightCubeShader->isReady()) {
+                glfwSwapBuffers(window);
+                glfwPollEvents();
+                continue;
+            }
+            shadersReady = true;
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - shaderBuildStart;
+            cout << "[LOG] > msg : All shaders ready after " << elapsed.count() << " ms" << endl;
+        }
 
-        lightCubeShader->setMat4("projection", projection);
-        lightCubeShader->setMat4("view", view);
-		
-		// we now draw as many light bulbs as we have point lights.
-		glBindVertexArray(lightCubeVAO);
-		for (unsigned int i = 0; i < 4; i++)
-        {
-			glm::mat4 model = glm::mat4(1.0f);
-			model = glm::translate(model, pointLightPositions[i]);
-			model = glm::scale(model, glm::vec3(0.2f)); // Make it smaller
-			lightCubeShader->setMat4("model", model);
-            glDrawArrays(GL_TRIANGLES, 0, 36);
+        // Swap in programs whose sources changed on disk once they have linked
+        shaderHotReloader.update();
+
+		// the light rig only changes where the spotlight follows the camera, upload() sends just those bytes
+		lightRig.set(lightRig.block.spotLight.position, camera.GetPosition());
+		lightRig.set(lightRig.block.spotLight.direction, camera.GetFront());
+		lightRig.upload();
+
+        // objects outside the view frustum cost neither a matrix, an upload slot nor a draw,
+        // the bounds are static so the masks only change when the camera does
+        if (camera.GetVersion() != culledCameraVersion) {
+            culledCameraVersion = camera.GetVersion();
+            FrustumCulling::cullSpheres(camera.GetFrustum(), cubeBounds, cubeVisible.data());
+            FrustumCulling::cullSpheres(camera.GetFrustum(), lightCubeBounds, lightCubeVisible.data());
+            instancesDirty = true;
         }
-        
 
+        // the draw order only changes with the camera : queue every visible object under its sort key,
+        // sort, then lay the instances (or the indirect commands) out in that order so every run of
+        // the queue is one contiguous range
+        if (instancesDirty) {
+            buildRenderQueue();
+            instancesDirty = false;
+        }
 
-        glBindVertexArray(0);
+        // one draw per run of equal state, opaque objects front to back inside it
+        unsigned int drawCalls = 0;
+        for (const RenderQueue::Run& run : renderQueue.getRuns()) {
+            Shader* shader = bindSceneProgram(RenderQueue::program(run.state));
+            bindSceneMaterial(RenderQueue::material(run.state));
+            if (useMultiDraw)
+                drawCalls += drawCommands.submit(*shader, run.first, run.count).calls;
+            else {
+                instanceBuffer.draw(cubeGeometry, run.first, run.count);
+                drawCalls++;
+            }
+        }
+
+        // the VAO stays bound into the next frame, nothing else in the loop binds one behind glState's back
+        GLStateCache::Stats stateStats = glState.endFrame();
+        if (currentFrame - stateStatsTime >= 5.0f) {
+            stateStatsTime = currentFrame;
+            cout << "[LOG] > msg : GL state calls last frame : issued " << stateStats.totalIssued() << ", elided " << stateStats.totalElided() << " (issued/elided : ";
+            for (int category = 0; category < GLStateCache::CATEGORY_COUNT; category++)
+                cout << (category ? ", " : "") << GLStateCache::categoryName(category) << " " << stateStats.issued[category] << "/" << stateStats.elided[category];
+            cout << ")" << endl;
+            cout << "[LOG] > msg : draws last frame : " << renderQueue.size() << " objects in " << renderQueue.getRuns().size() << " runs, "
+                << drawCalls << (useMultiDraw ? (glExt.multiDrawIndirect ? " indirect multi-draw calls" : " calls (no indirect multi-draw)") : " instanced calls") << endl;
+            RenderQueue::printStateChanges("[LOG] > msg : state changes unsorted : ", unsortedStateChanges);
+            RenderQueue::printStateChanges(", sorted : ", sortedStateChanges);
+            cout << endl;
+        }
 
         // Swap buffers and poll IO events
         glfwSwapBuffers(window);
@@ -581,66 +751,134 @@ void mainLoop() {
     }
 }
 
-// Ending process
-void cleanup() {
-    glDeleteVertexArrays(1, &cubeVAO);
-	glDeleteVertexArrays(1, &lightCubeVAO);
+void buildRenderQueue() {
+    const glm::vec3& eye = camera.GetPosition();
+    const glm::vec3& front = camera.GetFront();
+    unsigned int cubeCount = (unsigned int)cubeInstances.size();
+
+    // pushed in scene order, the order the loop used to draw them in
+    renderQueue.begin();
+    for (unsigned int i = 0; i < cubeCount; i++)
+        if (cubeVisible[i])
+            renderQueue.push(RenderQueue::makeKey(RenderQueue::PASS_OPAQUE, PROGRAM_LIGHTING, MATERIAL_CONTAINER, VERTEX_FORMAT_STANDARD,
+                glm::dot(cubePositions[i] - eye, front), camera.GetZFar()), i);
+    for (unsigned int i = 0; i < lightCubeInstances.size(); i++)
+        if (lightCubeVisible[i])
+            renderQueue.push(RenderQueue::makeKey(RenderQueue::PASS_OPAQUE, PROGRAM_LIGHT_CUBE, MATERIAL_NONE, VERTEX_FORMAT_STANDARD,
+                glm::dot(pointLightPositions[i] - eye, front), camera.GetZFar()), cubeCount + i);
+    renderQueue.sort(&unsortedStateChanges);
+    sortedStateChanges = RenderQueue::countStateChanges(renderQueue.getItems());
+
+    // item i of the queue becomes instance (or draw) i, a run is then a contiguous range
+    if (useMultiDraw)
+        drawCommands.begin();
+    else
+        instanceBuffer.begin();
+    for (const RenderQueue::Item& item : renderQueue.getItems()) {
+        const InstanceData& instance = item.payload < cubeCount ? cubeInstances[item.payload] : lightCubeInstances[item.payload - cubeCount];
+        if (useMultiDraw)
+            drawCommands.add(cubeGeometry, 0, cubeGeometry.indexCount, instance.model, glm::mat4(instance.normalMatrix));
+        else
+            instanceBuffer.push(instance);
+    }
+    if (useMultiDraw)
+        drawCommands.upload();
+    else
+        instanceBuffer.upload();
+}
 
-	if (lightingShader) {
-		delete lightingShader;
-        lightingShader = nullptr;
-	}
+// uses the program and sets its per-frame uniforms, the state cache drops the ones already set
+Shader* bindSceneProgram(unsigned int program) {
+    if (program == PROGRAM_LIGHT_CUBE) {
+        lightCubeShader->use();
+        lightCubeUniforms.bind(*lightCubeShader);
+        setProjection(lightCubeUniforms.projection);
+        setCameraTransform(lightCubeUniforms.view);
+        return lightCubeShader;
+    }
 
-    if(lightCubeShader){
-        delete lightCubeShader;
-        lightCubeShader = nullptr;
-	}
+    lightingShader->use();
+    lightingUniforms.bind(*lightingShader); // re-resolves only after a (re)link
+    lightingUniforms.viewPos.set(camera.GetPosition());
+    lightingUniforms.material.shininess.set(32.0f);
+    setProjection(lightingUniforms.projection);
+    setCameraTransform(lightingUniforms.view);
+    return lightingShader;
+}
+
+void bindSceneMaterial(unsigned int material) {
+    if (material != MATERIAL_CONTAINER)
+        return;
+    // Bind diffuse map (and the specular map), free when they are still bound from the last frame
+    glState.bindTexture(0, GL_TEXTURE_2D, diffuseMap);
+    glState.bindTexture(1, GL_TEXTURE_2D, specularMap);
+}
+
+// Ending process
+void cleanup() {
+    geometryArena.free(cubeGeometry);
+    geometryArena.destroy();
+    lightRig.destroy();
+    drawCommands.destroy();
+    instanceBuffer.destroy();
+    textureStreamer.stop();
+    textureManager.release(diffuseMap);
+    textureManager.release(specularMap);
+    textureManager.clear(); // anything still referenced goes with the context
+    textureStreamer.destroy();
+
+	// the library owns every program
+	shaderHotReloader.stop();
+	shaderLibrary.clear();
+	lightingShader = nullptr;
+	lightCubeShader = nullptr;
 }
   
 // Running process 
-void processInput(GLFWwindow* window) {
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+void simulationTick(float step) {
+    // everything the callbacks queued since the last tick, as held keys + summed deltas
+    inputQueue.drain(inputState);
+
+    if (inputState.isDown(GLFW_KEY_ESCAPE))
         glfwSetWindowShouldClose(window, true);
 
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-		camera.ProcessKeyboard(FORWARD, deltaTime);
-	if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-		camera.ProcessKeyboard(BACKWARD, deltaTime);
-	if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-		camera.ProcessKeyboard(LEFT, deltaTime);
-	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-		camera.ProcessKeyboard(RIGHT, deltaTime);
+    if (inputState.isDown(GLFW_KEY_W))
+		simulationCamera.ProcessKeyboard(FORWARD, step);
+	if (inputState.isDown(GLFW_KEY_S))
+		simulationCamera.ProcessKeyboard(BACKWARD, step);
+	if (inputState.isDown(GLFW_KEY_A))
+		simulationCamera.ProcessKeyboard(LEFT, step);
+	if (inputState.isDown(GLFW_KEY_D))
+		simulationCamera.ProcessKeyboard(RIGHT, step);
+
+    // one orientation update per tick however many cursor events there were
+    if (inputState.mouseDeltaX != 0.0f || inputState.mouseDeltaY != 0.0f)
+        simulationCamera.ProcessMouseMovement(inputState.mouseDeltaX, inputState.mouseDeltaY);
+    if (inputState.scroll != 0.0f)
+        simulationCamera.ProcessMouseScroll(inputState.scroll);
+}
+
+// glfw : key presses and releases, queued for the next simulation tick
+// -----------------------------------------------------------------------
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+    inputQueue.pushKey(key, action);
 }
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
     glViewport(0, 0, width, height);
+    if (height > 0)
+        camera.SetAspect((float)width / (float)height);
 }
 
 // glfw : whenever the mouse moves, this function is called
 // -----------------------------------------------------------------------
 void mouse_callback(GLFWwindow* window, double xposIn, double yposIn) {
-
-    float xpos = static_cast<float>(xposIn);
-    float ypos = static_cast<float>(yposIn);
-
-    if (firstMouse)
-    {
-        lastX = xpos;
-        lastY = ypos;
-        firstMouse = false;
-    }
-
-    float xoffset = xpos - lastX;
-    float yoffset = lastY - ypos; // reversed since y-coordinates go from bottom to top
-
-    lastX = xpos;
-    lastY = ypos;
-
-    camera.ProcessMouseMovement(xoffset, yoffset);
+    // only queued, the simulation turns positions into one accumulated offset per tick
+    inputQueue.pushCursor(xposIn, yposIn);
 }
 
 // glfw : whenever the mouse scroll wheel is used, this function is called
 // -----------------------------------------------------------------------
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
-	camera.ProcessMouseScroll(static_cast<float>(yoffset));
+	inputQueue.pushScroll(xoffset, yoffset);
 }
\ No newline at end of file
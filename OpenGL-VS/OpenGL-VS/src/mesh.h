@@ -1,7 +1,5 @@
-#define Mesh_H
-
-#ifdef Mesh_H
-#define Mesh_H
+#ifndef MESH_H
+#define MESH_H
 
 #include <glad/glad.h> // holds all OpenGL type declarations
 
@@ -9,8 +7,20 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "shaders/shader_s.h"
+#include "draw_commands.h"
+#include "geometry_arena.h"
+#include "lod_selector.h"
+#include "mesh_optimizer.h"
+#include "mesh_simplifier.h"
+#include "meshlets.h"
+#include "object_constants.h"
+#include "vertex_quantization.h"
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <utility>
 #include <vector>
 
 using namespace std;
@@ -18,90 +28,395 @@ using namespace std;
 struct Vertex {
 	glm::vec3 Position;
 	glm::vec3 Normal;
-    glm::vec2 TexCoords;
+	glm::vec2 TexCoords;
+};
+static_assert(sizeof(Vertex) == 32 && offsetof(Vertex, Normal) == 12 && offsetof(Vertex, TexCoords) == 24,
+	"Vertex must match VERTEX_FORMAT_STANDARD of the geometry arena");
+
+// what a texture is used for, each type has its own sampler array in the shader
+enum TextureType {
+	TEXTURE_DIFFUSE,
+	TEXTURE_SPECULAR,
+	TEXTURE_NORMAL,
+	TEXTURE_HEIGHT,
+	TEXTURE_TYPE_COUNT
 };
 
+// sampler name prefix of a type, the N-th texture of it is bound to "<prefix>N" (1 based)
+inline const char* textureTypeName(TextureType type)
+{
+	static const char* names[TEXTURE_TYPE_COUNT] = { "texture_diffuse", "texture_specular", "texture_normal", "texture_height" };
+	return names[type];
+}
+
 struct Texture {
-    unsigned int id;
-    std::string type;
+	unsigned int id;
+	TextureType type;
+};
+
+// What a Mesh keeps on the CPU once its geometry is on the GPU
+struct MeshOptions {
+	enum CpuCopy {
+		CPU_COPY_NONE,    // nothing, the vertex and index data are released right after upload
+		CPU_COPY_COMPACT, // positions and indices only, enough for picking, bounds and collision
+		CPU_COPY_FULL     // the complete vertices and indices
+	};
+	CpuCopy cpuCopy = CPU_COPY_NONE;
+	// reorder indices and vertices for the post-transform cache, overdraw and fetch
+	// before upload (MeshOptimizer::optimizeMesh), logging ACMR / ATVR before and after
+	bool optimize = false;
+	// upload as 16 byte QuantizedVertex instead of the 32 byte Vertex,
+	// the mesh must then be drawn with a QUANTIZED_VERTICES shader
+	bool quantize = false;
+	// simplified levels generated after the source (MeshSimplifier::generateLodChain), each aiming
+	// for lodReduction times the triangles of the one before, stored behind it in the same index range
+	int lodLevels = 0;
+	float lodReduction = 0.5f;
+	// split level 0 into meshlets (Meshlets::build) so DrawVisible can skip hidden clusters
+	bool meshlets = false;
+};
+
+// one level of detail, a range of the mesh's index buffer
+struct MeshLod {
+	size_t indexOffset; // in indices
+	size_t indexCount;
+	float error;        // object space distance from the source surface, 0 for level 0
 };
 
+// A drawable piece of geometry owning a vertex and an index range of the geometry arena,
+// drawn through the arena's VAO for its vertex format.
+// Move-only: the ranges are freed with the last owner, so a Mesh can live in a vector
+// (moved, never copied) but never be duplicated by accident.
 class Mesh {
 public:
-	// mesh data
-    vector<Vertex> vertices;
-	vector<unsigned int> indices;
+	// mesh data, filled according to MeshOptions::cpuCopy
+	vector<Vertex> vertices;       // CPU_COPY_FULL
+	vector<glm::vec3> positions;   // CPU_COPY_COMPACT
+	vector<unsigned int> indices;  // CPU_COPY_FULL and CPU_COPY_COMPACT
 	vector<Texture> textures;
 
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures) {
-	
-		this->vertices = vertices;
-		this->indices = indices;
-		this->textures = textures;
+	// takes the data over without copying it, with CPU_COPY_NONE it is freed once uploaded
+	Mesh(vector<Vertex>&& vertices, vector<unsigned int>&& indices, vector<Texture>&& textures, MeshOptions options = MeshOptions())
+		: textures(std::move(textures))
+	{
+		vector<Vertex> vertexData = std::move(vertices);
+		vector<unsigned int> indexData = std::move(indices);
+		create(vertexData, indexData, options);
+	}
 
-		setupMesh();
+	// uploads straight from memory the caller owns (a loader's buffer, a static array),
+	// only what cpuCopy asks for is copied
+	Mesh(const Vertex* vertexData, size_t vertexCount, const unsigned int* indexData, size_t indexCount, vector<Texture> textures, MeshOptions options = MeshOptions())
+		: textures(std::move(textures))
+	{
+		if (options.optimize || options.lodLevels > 0 || options.meshlets) {
+			// the optimizer, simplifier and meshlet builder work on vectors, so they need their own copy
+			vector<Vertex> vertexCopy(vertexData, vertexData + vertexCount);
+			vector<unsigned int> indexCopy(indexData, indexData + indexCount);
+			create(vertexCopy, indexCopy, options);
+			return;
+		}
+
+		setupMesh(vertexData, vertexCount, indexData, indexCount, options.quantize);
+
+		if (options.cpuCopy == MeshOptions::CPU_COPY_FULL)
+			this->vertices.assign(vertexData, vertexData + vertexCount);
+		if (options.cpuCopy == MeshOptions::CPU_COPY_COMPACT)
+			keepPositions(this->positions, vertexData, vertexCount);
+		if (options.cpuCopy != MeshOptions::CPU_COPY_NONE)
+			this->indices.assign(indexData, indexData + indexCount);
 	}
-	void Draw(Shader& shader) {
-		
-		unsigned int diffuseNr = 1;
-		unsigned int specularNr = 1;
-		for (unsigned int i = 0; i < textures.size(); i++) {
-			glActiveTexture(GL_TEXTURE0 + i); // activate proper texture unit before binding
-			// retrieve texture number (the N in diffuse_textureN)
-			string number;
-			string name = textures[i].type;
-			if (name == "texture_diffuse") {
-				number = std::to_string(diffuseNr++);
-			}
-			else if (name == "texture_specular") {
-				number = std::to_string(specularNr++);
-			}
-			shader.setInt((name + number).c_str(), i);
-			glBindTexture(GL_TEXTURE_2D, textures[i].id);
+
+	Mesh(const Mesh&) = delete;
+	Mesh& operator=(const Mesh&) = delete;
+
+	Mesh(Mesh&& other) noexcept
+	{
+		*this = std::move(other);
+	}
+
+	Mesh& operator=(Mesh&& other) noexcept
+	{
+		if (this != &other) {
+			release();
+			vertices = std::move(other.vertices);
+			positions = std::move(other.positions);
+			indices = std::move(other.indices);
+			textures = std::move(other.textures);
+			geometry = other.geometry;
+			vertexCount = other.vertexCount;
+			totalIndexCount = other.totalIndexCount;
+			lods = std::move(other.lods);
+			boundsCenter = other.boundsCenter;
+			boundsRadius = other.boundsRadius;
+			quantized = other.quantized;
+			bounds = other.bounds;
+			samplers = std::move(other.samplers);
+			meshlets = std::move(other.meshlets);
+			other.geometry = GeometryAllocation();
+			other.vertexCount = other.totalIndexCount = 0;
 		}
+		return *this;
+	}
+
+	~Mesh()
+	{
+		release();
+	}
 
-		glActiveTexture(GL_TEXTURE0);
+	// texture i goes to unit i, the sampler locations are looked up once per program
+	// (bindShader), so this is only binds and already shadowed uniform writes.
+	// model / normalMatrix come from slot of objects, pushed and uploaded by the caller this frame.
+	void Draw(Shader& shader, const ObjectConstantsBuffer& objects, unsigned int slot, int lod = 0) {
+		bindForDraw(shader);
+		objects.bind(slot);
 
 		//draw mesh
-		glBindVertexArray(VAO);
-		glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-		glBindVertexArray(0);
+		const MeshLod& level = lods[std::min(std::max(lod, 0), (int)lods.size() - 1)];
+		geometryArena.draw(geometry, level.indexOffset, level.indexCount);
 	};
+
+	// Draws level 0 without the meshlets that are outside the frustum or entirely back facing,
+	// the survivors in one glMultiDrawElementsBaseVertex. Without meshlets it is Draw().
+	// model (the one in slot of objects) must not scale non-uniformly, the cone test runs in object space.
+	Meshlets::CullStats DrawVisible(Shader& shader, const ObjectConstantsBuffer& objects, unsigned int slot,
+		const glm::mat4& viewProjection, const glm::mat4& model, const glm::vec3& cameraPosition)
+	{
+		if (meshlets.empty()) {
+			Draw(shader, objects, slot);
+			return Meshlets::CullStats();
+		}
+
+		Frustum frustum = Frustum::fromMatrix(viewProjection * model);
+		glm::vec3 localCamera = glm::vec3(glm::inverse(model) * glm::vec4(cameraPosition, 1.0f));
+		Meshlets::CullStats stats = Meshlets::cull(meshlets, frustum, localCamera, geometry.indexSize(), drawCounts, drawOffsets);
+		if (drawCounts.empty())
+			return stats;
+
+		bindForDraw(shader);
+		objects.bind(slot);
+		geometryArena.multiDraw(geometry, drawCounts.data(), drawOffsets.data(), drawCounts.size());
+		return stats;
+	}
+
+	const vector<Meshlet>& getMeshlets() const { return meshlets; }
+
+	// Queues a level for builder.submit() instead of drawing it now. The caller binds the
+	// textures, all meshes of one submit share them. Quantized positions need no uniforms
+	// there : the bounds are folded into the draw's model matrix, the normal matrix keeps model's.
+	unsigned int AddDraw(DrawCommandBuilder& builder, const glm::mat4& model, int lod = 0) const
+	{
+		const MeshLod& level = lods[std::min(std::max(lod, 0), (int)lods.size() - 1)];
+		glm::mat4 normalMatrix = glm::mat4(glm::transpose(glm::inverse(glm::mat3(model))));
+		glm::mat4 positionMatrix = quantized ? glm::scale(glm::translate(model, bounds.offset), bounds.scale) : model;
+		return builder.add(geometry, level.indexOffset, level.indexCount, positionMatrix, normalMatrix);
+	}
+
+	// resolves the uniforms Draw sets against shader, redone automatically when the
+	// program changes (another shader, a hot reload) or the texture list does
+	void bindShader(Shader& shader)
+	{
+		samplers.program = shader.ID;
+		// the default permutation reads its matrices from the Object block
+		shader.bindUniformBlock("Object", ObjectConstantsBuffer::BINDING);
+		samplers.locations.resize(textures.size());
+
+		// retrieve texture number (the N in diffuse_textureN)
+		unsigned int count[TEXTURE_TYPE_COUNT] = {};
+		for (size_t i = 0; i < textures.size(); i++) {
+			TextureType type = textures[i].type;
+			string name = textureTypeName(type) + std::to_string(++count[type]);
+			samplers.locations[i] = shader.uniformLocation(name);
+		}
+		samplers.positionOffset = shader.uniformLocation("positionOffset");
+		samplers.positionScale = shader.uniformLocation("positionScale");
+	}
+
+	size_t getVertexCount() const { return vertexCount; }
+	// indices of level 0
+	size_t getIndexCount() const { return lods.empty() ? 0 : lods[0].indexCount; }
+	const vector<MeshLod>& getLods() const { return lods; }
+	// object space bounding sphere
+	const glm::vec3& getBoundsCenter() const { return boundsCenter; }
+	float getBoundsRadius() const { return boundsRadius; }
+
+	// level to draw this frame for the mesh placed with model, current is last frame's level
+	int selectLod(const LodSelector& selector, const Camera& camera, const glm::mat4& model, int current) const
+	{
+		glm::vec3 center = glm::vec3(model * glm::vec4(boundsCenter, 1.0f));
+		float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+		return selector.select(camera, center, boundsRadius * scale, scale, lods, current);
+	}
+	// true when the vertices are QuantizedVertex, draw with a QUANTIZED_VERTICES shader
+	bool isQuantized() const { return quantized; }
+	const QuantizationBounds& getBounds() const { return bounds; }
+	// bytes of vertex and index data on the GPU
+	size_t getGpuSize() const
+	{
+		return vertexCount * (quantized ? sizeof(QuantizedVertex) : sizeof(Vertex)) +
+			totalIndexCount * geometry.indexSize();
+	}
+
 private:
 	// render data
-	unsigned int VAO, VBO, EBO;
-	
-	// initializes all the buffer objects/arrays
-	void setupMesh()
-	{
-		glGenVertexArrays(1, &VAO);
-		glGenBuffers(1, &VBO);
-		glGenBuffers(1, &EBO);
-
-		glBindVertexArray(VAO);
-		glBindBuffer(GL_ARRAY_BUFFER, VBO);
-
-		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-	
-
-		//vertex positions
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-		// vertex normals
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-		// vertex texture coords
-		glEnableVertexAttribArray(2);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+	GeometryAllocation geometry;
+	// the counts survive the CPU data being dropped
+	size_t vertexCount = 0;
+	size_t totalIndexCount = 0; // all levels
+	bool quantized = false;
+	QuantizationBounds bounds;
+	vector<MeshLod> lods;
+	vector<Meshlet> meshlets; // over level 0
+	// DrawVisible's ranges, kept to reuse their memory
+	vector<GLsizei> drawCounts;
+	vector<const void*> drawOffsets;
+	glm::vec3 boundsCenter = glm::vec3(0.0f);
+	float boundsRadius = 0.0f;
+
+	// uniform locations Draw needs, valid for one program
+	struct SamplerTable {
+		unsigned int program = 0;
+		vector<int> locations; // per texture
+		int positionOffset = -1;
+		int positionScale = -1;
+	} samplers;
+
+	// takes its ranges from the geometry arena and uploads the vertices and indices
+	void setupMesh(const Vertex* vertexData, size_t vertexCount, const unsigned int* indexData, size_t indexCount, bool quantize)
+	{
+		this->vertexCount = vertexCount;
+		this->totalIndexCount = indexCount;
+		this->quantized = quantize;
+		lods.assign(1, MeshLod{ 0, indexCount, 0.0f });
+
+		// bounding sphere around the box, for culling and LOD selection
+		if (vertexCount > 0) {
+			glm::vec3 lo = vertexData[0].Position, hi = vertexData[0].Position;
+			for (size_t i = 1; i < vertexCount; i++) {
+				lo = glm::min(lo, vertexData[i].Position);
+				hi = glm::max(hi, vertexData[i].Position);
+			}
+			boundsCenter = (lo + hi) * 0.5f;
+			boundsRadius = 0.0f;
+			for (size_t i = 0; i < vertexCount; i++)
+				boundsRadius = std::max(boundsRadius, glm::length(vertexData[i].Position - boundsCenter));
+		}
+
+		// every index fits in 16 bits below 65536 vertices, halving the index range
+		GLenum indexType = vertexCount <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+		geometry = geometryArena.allocate(quantize ? VERTEX_FORMAT_QUANTIZED : VERTEX_FORMAT_STANDARD, vertexCount, indexCount, indexType);
+		if (!geometry.valid())
+			return;
 
+		vector<QuantizedVertex> packed;
+		const void* vertexUpload = vertexData;
+		if (quantize) {
+			bounds = VertexQuantization::computeBounds(vertexData, vertexCount);
+			packed.resize(vertexCount);
+			for (size_t i = 0; i < vertexCount; i++)
+				packed[i] = VertexQuantization::quantize(vertexData[i], bounds);
+			vertexUpload = packed.data();
+		}
+
+		if (indexType == GL_UNSIGNED_SHORT) {
+			vector<uint16_t> shortIndices(indexData, indexData + indexCount);
+			geometryArena.upload(geometry, vertexUpload, shortIndices.data());
+		}
+		else
+			geometryArena.upload(geometry, vertexUpload, indexData);
 	};
-};
 
+	// Object block, samplers, quantization uniforms and the VAO
+	void bindForDraw(Shader& shader)
+	{
+		if (shader.ID != samplers.program || samplers.locations.size() != textures.size())
+			bindShader(shader);
+
+		for (unsigned int i = 0; i < textures.size(); i++) {
+			glState.uniform1i(samplers.locations[i], (int)i);
+			glState.bindTexture(i, GL_TEXTURE_2D, textures[i].id); // activates the unit only when it has to
+		}
+
+		// undo the position quantization
+		if (quantized) {
+			glState.uniform3fv(samplers.positionOffset, &bounds.offset[0]);
+			glState.uniform3fv(samplers.positionScale, &bounds.scale[0]);
+		}
+
+		geometryArena.bind(geometry.format);
+	}
 
+	// optimizes and uploads data it may consume, then keeps what cpuCopy asks for
+	void create(vector<Vertex>& vertexData, vector<unsigned int>& indexData, const MeshOptions& options)
+	{
+		if (options.optimize) {
+			MeshOptimizer::Report report = MeshOptimizer::optimizeMesh(vertexData, indexData, &Vertex::Position);
+			MeshOptimizer::printReport(report, indexData.size() / 3);
+		}
+
+		if (options.meshlets && !vertexData.empty()) {
+			meshlets = Meshlets::build(indexData.data(), indexData.size(), &vertexData[0].Position[0], vertexData.size(), sizeof(Vertex));
+			cout << "[LOG] > mesh meshlets : " << meshlets.size() << " clusters for " << indexData.size() / 3 << " triangles" << endl;
+		}
+
+		if (options.lodLevels <= 0) {
+			setupMesh(vertexData.data(), vertexData.size(), indexData.data(), indexData.size(), options.quantize);
+			keepCpuCopy(vertexData, indexData, options);
+			return;
+		}
+
+		// every level indexes the same vertices, their index lists go back to back into one index range
+		vector<MeshSimplifier::Level> chain = MeshSimplifier::generateLodChain(vertexData, indexData, options.lodLevels, options.lodReduction);
+		vector<unsigned int> allIndices;
+		vector<MeshLod> levels;
+		for (size_t i = 0; i < chain.size(); i++) {
+			vector<unsigned int>& levelIndices = chain[i].indices;
+			if (i > 0 && options.optimize) {
+				vector<unsigned int> cacheOrder(levelIndices.size());
+				MeshOptimizer::optimizeVertexCache(cacheOrder.data(), levelIndices.data(), levelIndices.size(), vertexData.size());
+				levelIndices.swap(cacheOrder);
+			}
+			levels.push_back(MeshLod{ allIndices.size(), levelIndices.size(), chain[i].error });
+			allIndices.insert(allIndices.end(), levelIndices.begin(), levelIndices.end());
+			cout << "[LOG] > mesh lod : level " << i << " : " << levelIndices.size() / 3 << " triangles, error " << chain[i].error << endl;
+		}
+
+		setupMesh(vertexData.data(), vertexData.size(), allIndices.data(), allIndices.size(), options.quantize);
+		lods = std::move(levels);
+		keepCpuCopy(vertexData, indexData, options);
+	}
+
+	// keeps what cpuCopy asks for of the level 0 data
+	void keepCpuCopy(vector<Vertex>& vertexData, vector<unsigned int>& indexData, const MeshOptions& options)
+	{
+		switch (options.cpuCopy) {
+		case MeshOptions::CPU_COPY_FULL:
+			this->vertices = std::move(vertexData);
+			this->indices = std::move(indexData);
+			break;
+		case MeshOptions::CPU_COPY_COMPACT:
+			keepPositions(this->positions, vertexData.data(), vertexData.size());
+			this->indices = std::move(indexData);
+			break;
+		case MeshOptions::CPU_COPY_NONE:
+			break;
+		}
+	}
+
+	static void keepPositions(vector<glm::vec3>& positions, const Vertex* vertexData, size_t vertexCount)
+	{
+		positions.resize(vertexCount);
+		for (size_t i = 0; i < vertexCount; i++)
+			positions[i] = vertexData[i].Position;
+	}
+
+	// gives the ranges back to the arena
+	void release()
+	{
+		geometryArena.free(geometry);
+	}
+};
 
-#endif // Mesh_H
 
 
+#endif // MESH_H
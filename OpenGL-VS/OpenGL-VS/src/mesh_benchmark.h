@@ -0,0 +1,139 @@
+#ifndef MESH_BENCHMARK_H
+#define MESH_BENCHMARK_H
+
+#include <glm/glm.hpp>
+
+#include "camera.h"
+#include "frustum_culling.h"
+#include "lod_selector.h"
+#include "mesh.h"
+#include "mesh_optimizer.h"
+#include "mesh_simplifier.h"
+#include "meshlets.h"
+#include "vertex_quantization.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+// Runs the CPU side of the Mesh load pipeline (optimize, quantize, LOD chain, meshlets) on a
+// generated height field and logs what each stage does, no window or GL context needed.
+// Started with --bench-mesh, like --bench-culling for the frustum kernels.
+namespace MeshBenchmark
+{
+	// gridSize x gridSize quads over 20 x 20 units, rolling hills so the simplifier has
+	// curvature to keep, indices in row order the way a plain exporter writes them
+	inline void buildGrid(unsigned int gridSize, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+	{
+		const unsigned int side = gridSize + 1;
+		vertices.resize((size_t)side * side);
+		for (unsigned int z = 0; z < side; z++) {
+			for (unsigned int x = 0; x < side; x++) {
+				float u = (float)x / gridSize, v = (float)z / gridSize;
+				float px = (u - 0.5f) * 20.0f, pz = (v - 0.5f) * 20.0f;
+				Vertex& vertex = vertices[(size_t)z * side + x];
+				vertex.Position = glm::vec3(px, 0.5f * std::sin(px) * std::cos(pz), pz);
+				// gradient of the height, y = 0.5 sin(x) cos(z)
+				vertex.Normal = glm::normalize(glm::vec3(-0.5f * std::cos(px) * std::cos(pz), 1.0f, 0.5f * std::sin(px) * std::sin(pz)));
+				vertex.TexCoords = glm::vec2(u, v);
+			}
+		}
+
+		indices.clear();
+		indices.reserve((size_t)gridSize * gridSize * 6);
+		for (unsigned int z = 0; z < gridSize; z++) {
+			for (unsigned int x = 0; x < gridSize; x++) {
+				unsigned int i = z * side + x;
+				// counter-clockwise seen from above
+				indices.insert(indices.end(), { i, i + side, i + 1, i + 1, i + side, i + side + 1 });
+			}
+		}
+	}
+
+	inline double millisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	inline void run(unsigned int gridSize = 256)
+	{
+		std::vector<Vertex> vertices;
+		std::vector<unsigned int> indices;
+		buildGrid(gridSize, vertices, indices);
+		size_t triangleCount = indices.size() / 3;
+		std::cout << "[LOG] > msg : Mesh benchmark, " << gridSize << " x " << gridSize << " grid, "
+			<< vertices.size() << " vertices, " << triangleCount << " triangles" << std::endl;
+
+		// 1. cache / overdraw / fetch order
+		auto start = std::chrono::steady_clock::now();
+		MeshOptimizer::Report report = MeshOptimizer::optimizeMesh(vertices, indices, &Vertex::Position);
+		double optimizeTime = millisecondsSince(start);
+		MeshOptimizer::printReport(report, triangleCount);
+		std::cout << "[LOG] > msg : optimizeMesh " << optimizeTime << " ms" << std::endl;
+
+		// 2. quantization round trip, decoded the way basic_lighting.vs does it
+		QuantizationBounds bounds = VertexQuantization::computeBounds(vertices.data(), vertices.size());
+		float positionError = 0.0f, normalError = 0.0f;
+		for (const Vertex& vertex : vertices) {
+			QuantizedVertex packed = VertexQuantization::quantize(vertex, bounds);
+			glm::vec3 position = glm::vec3(packed.Position[0], packed.Position[1], packed.Position[2]) / 65535.0f * bounds.scale + bounds.offset;
+			positionError = std::max(positionError, glm::length(position - vertex.Position));
+
+			glm::vec2 e = glm::max(glm::vec2(packed.Normal[0], packed.Normal[1]) / 32767.0f, glm::vec2(-1.0f));
+			glm::vec3 n(e, 1.0f - std::abs(e.x) - std::abs(e.y));
+			float t = std::max(-n.z, 0.0f);
+			n.x += n.x >= 0.0f ? -t : t;
+			n.y += n.y >= 0.0f ? -t : t;
+			normalError = std::max(normalError, glm::length(glm::normalize(n) - vertex.Normal));
+		}
+		std::cout << "[LOG] > msg : quantized 32 -> " << sizeof(QuantizedVertex) << " bytes per vertex, max error position "
+			<< positionError << " (extent 20), normal " << normalError << std::endl;
+
+		// 3. LOD chain, and the level the selector picks as the grid moves away
+		start = std::chrono::steady_clock::now();
+		std::vector<MeshSimplifier::Level> chain = MeshSimplifier::generateLodChain(vertices, indices, 4);
+		double lodTime = millisecondsSince(start);
+		for (size_t level = 0; level < chain.size(); level++)
+			std::cout << "[LOG] > msg : LOD " << level << " : " << chain[level].indices.size() / 3 << " triangles, error " << chain[level].error << std::endl;
+		std::cout << "[LOG] > msg : generateLodChain " << lodTime << " ms" << std::endl;
+
+		LodSelector selector;
+		float radius = 0.0f;
+		for (const Vertex& vertex : vertices)
+			radius = std::max(radius, glm::length(vertex.Position));
+		std::cout << "[LOG] > msg : LOD selected at distance";
+		int lod = 0;
+		for (float distance : { 15.0f, 30.0f, 60.0f, 120.0f, 240.0f, 480.0f }) {
+			Camera camera(glm::vec3(0.0f, 0.0f, distance));
+			lod = selector.select(camera, glm::vec3(0.0f), radius, 1.0f, chain, lod);
+			std::cout << " " << distance << " : " << lod << (distance < 480.0f ? "," : "");
+		}
+		std::cout << std::endl;
+
+		// 4. meshlets, culled from above the hills (frustum) and from underneath (back faces)
+		start = std::chrono::steady_clock::now();
+		std::vector<Meshlet> meshlets = Meshlets::build(indices.data(), indices.size(), &vertices[0].Position[0], vertices.size(), sizeof(Vertex));
+		double meshletTime = millisecondsSince(start);
+		std::cout << "[LOG] > msg : " << meshlets.size() << " meshlets in " << meshletTime << " ms" << std::endl;
+
+		struct View { const char* name; Camera camera; };
+		View views[] = {
+			{ "above", Camera(glm::vec3(0.0f, 3.0f, 4.0f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, -20.0f) },
+			{ "below", Camera(glm::vec3(0.0f, -6.0f, 12.0f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, 30.0f) },
+		};
+		std::vector<int> counts;
+		std::vector<const void*> offsets;
+		for (const View& view : views) {
+			Frustum frustum = Frustum::fromMatrix(view.camera.GetViewProjectionMatrix());
+			Meshlets::CullStats stats = Meshlets::cull(meshlets, frustum, view.camera.GetPosition(), sizeof(unsigned int), counts, offsets);
+			std::cout << "[LOG] > msg : meshlets seen from " << view.name << " : " << stats.frustumCulled << " outside the frustum, "
+				<< stats.backfaceCulled << " back facing, " << stats.total - stats.frustumCulled - stats.backfaceCulled
+				<< " drawn in " << stats.ranges << " ranges" << std::endl;
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,360 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+// Load time reordering of indexed triangle lists, run in this order:
+//   1. optimizeVertexCache : Forsyth's linear-speed vertex cache optimisation, triangles that
+//      share vertices are emitted close together so the post-transform cache hits more often
+//   2. optimizeOverdraw    : splits that order into clusters at cache restarts (Tipsify style)
+//      and sorts the clusters to draw outward facing, convex-hull-ish parts first
+//   3. optimizeVertexFetch : renumbers vertices in first-use order so the vertex fetch walks
+//      the vertex buffer front to back
+// The stages only permute data, the mesh renders exactly the same.
+namespace MeshOptimizer
+{
+	// FIFO size the statistics assume, close to what current GPUs behave like
+	constexpr unsigned int ANALYZE_CACHE_SIZE = 16;
+
+	// post-transform vertex cache behaviour of an index order
+	struct CacheStats
+	{
+		unsigned int transformedVertices = 0;
+		float acmr = 0.0f; // average cache miss ratio : vertex shader runs per triangle, 0.5 is the ideal for big grids, 3 the worst
+		float atvr = 0.0f; // average transform to vertex ratio : vertex shader runs per vertex, 1 is optimal
+	};
+
+	// simulates a FIFO cache over the index list
+	inline CacheStats analyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = ANALYZE_CACHE_SIZE)
+	{
+		CacheStats stats;
+		if (indexCount == 0 || vertexCount == 0)
+			return stats;
+
+		// a vertex is in the cache while fewer than cacheSize misses happened since it was loaded
+		std::vector<unsigned int> loadedAt(vertexCount, 0);
+		std::vector<bool> referenced(vertexCount, false);
+		unsigned int misses = 0;
+		size_t uniqueVertices = 0;
+		for (size_t i = 0; i < indexCount; i++) {
+			unsigned int index = indices[i];
+			if (!referenced[index]) {
+				referenced[index] = true;
+				uniqueVertices++;
+			}
+			else if (misses - loadedAt[index] < cacheSize)
+				continue;
+			loadedAt[index] = misses;
+			misses++;
+		}
+
+		stats.transformedVertices = misses;
+		stats.acmr = (float)misses / (float)(indexCount / 3);
+		stats.atvr = (float)misses / (float)uniqueVertices;
+		return stats;
+	}
+
+	// ---- 1. vertex cache order ---------------------------------------------------------
+
+	namespace Forsyth
+	{
+		constexpr int CACHE_SIZE = 32;
+		constexpr float CACHE_DECAY_POWER = 1.5f;
+		constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+		constexpr float VALENCE_BOOST_SCALE = 2.0f;
+		constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+		// cachePosition -1 when not in the cache
+		inline float vertexScore(int cachePosition, unsigned int remainingTriangles)
+		{
+			if (remainingTriangles == 0)
+				return -1.0f; // nothing left to draw with it
+
+			float score = 0.0f;
+			if (cachePosition >= 0) {
+				if (cachePosition < 3)
+					score = LAST_TRIANGLE_SCORE; // used by the triangle just emitted, fixed score so no triangle is favoured by order alone
+				else
+					score = std::pow(1.0f - (float)(cachePosition - 3) / (float)(CACHE_SIZE - 3), CACHE_DECAY_POWER);
+			}
+			// vertices with few triangles left get a boost, finishing them frees the cache
+			score += VALENCE_BOOST_SCALE * std::pow((float)remainingTriangles, -VALENCE_BOOST_POWER);
+			return score;
+		}
+	}
+
+	// writes the triangles of indices in cache friendly order to destination (may not alias indices)
+	inline void optimizeVertexCache(unsigned int* destination, const unsigned int* indices, size_t indexCount, size_t vertexCount)
+	{
+		using namespace Forsyth;
+
+		size_t triangleCount = indexCount / 3;
+		if (triangleCount == 0)
+			return;
+
+		// triangles of every vertex, as one offset table plus a flat list
+		std::vector<unsigned int> remaining(vertexCount, 0);
+		for (size_t i = 0; i < indexCount; i++)
+			remaining[indices[i]]++;
+		std::vector<size_t> adjacencyOffset(vertexCount + 1, 0);
+		for (size_t v = 0; v < vertexCount; v++)
+			adjacencyOffset[v + 1] = adjacencyOffset[v] + remaining[v];
+		std::vector<unsigned int> adjacency(indexCount);
+		{
+			std::vector<size_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+			for (size_t t = 0; t < triangleCount; t++)
+				for (int k = 0; k < 3; k++)
+					adjacency[fill[indices[t * 3 + k]]++] = (unsigned int)t;
+		}
+
+		std::vector<int> cachePosition(vertexCount, -1);
+		std::vector<float> vertexScores(vertexCount);
+		for (size_t v = 0; v < vertexCount; v++)
+			vertexScores[v] = vertexScore(-1, remaining[v]);
+
+		std::vector<float> triangleScores(triangleCount);
+		std::vector<bool> emitted(triangleCount, false);
+		for (size_t t = 0; t < triangleCount; t++)
+			triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+
+		// LRU cache, 3 extra slots hold the vertices pushed out by the newest triangle
+		std::vector<unsigned int> cache, nextCache;
+		cache.reserve(CACHE_SIZE + 3);
+		nextCache.reserve(CACHE_SIZE + 3);
+
+		size_t inputCursor = 0; // fallback when nothing in the cache has triangles left
+		long bestTriangle = -1;
+		float bestScore = -1.0f;
+		for (size_t t = 0; t < triangleCount; t++)
+			if (triangleScores[t] > bestScore) {
+				bestScore = triangleScores[t];
+				bestTriangle = (long)t;
+			}
+
+		size_t outputTriangle = 0;
+		while (outputTriangle < triangleCount) {
+			if (bestTriangle < 0) {
+				while (emitted[inputCursor])
+					inputCursor++;
+				bestTriangle = (long)inputCursor;
+			}
+
+			const unsigned int* triangle = &indices[bestTriangle * 3];
+			emitted[bestTriangle] = true;
+			destination[outputTriangle * 3 + 0] = triangle[0];
+			destination[outputTriangle * 3 + 1] = triangle[1];
+			destination[outputTriangle * 3 + 2] = triangle[2];
+			outputTriangle++;
+
+			// drop the triangle from the adjacency of its vertices
+			for (int k = 0; k < 3; k++) {
+				unsigned int v = triangle[k];
+				unsigned int* begin = &adjacency[adjacencyOffset[v]];
+				unsigned int* end = begin + remaining[v];
+				unsigned int* found = std::find(begin, end, (unsigned int)bestTriangle);
+				if (found != end) {
+					*found = *(end - 1);
+					remaining[v]--;
+				}
+			}
+
+			// move the triangle's vertices to the front of the cache
+			nextCache.clear();
+			for (int k = 0; k < 3; k++)
+				if (std::find(nextCache.begin(), nextCache.end(), triangle[k]) == nextCache.end())
+					nextCache.push_back(triangle[k]);
+			for (unsigned int v : cache)
+				if (std::find(nextCache.begin(), nextCache.end(), v) == nextCache.end())
+					nextCache.push_back(v);
+
+			// rescore everything that was or is in the cache, and their triangles
+			for (size_t i = 0; i < nextCache.size(); i++) {
+				unsigned int v = nextCache[i];
+				cachePosition[v] = i < (size_t)CACHE_SIZE ? (int)i : -1;
+			}
+			for (unsigned int v : nextCache) {
+				float score = vertexScore(cachePosition[v], remaining[v]);
+				float delta = score - vertexScores[v];
+				vertexScores[v] = score;
+				for (unsigned int a = 0; a < remaining[v]; a++)
+					triangleScores[adjacency[adjacencyOffset[v] + a]] += delta;
+			}
+			// the next triangle comes from the cache whenever it has one left to give
+			bestTriangle = -1;
+			bestScore = -1.0f;
+			for (unsigned int v : nextCache)
+				for (unsigned int a = 0; a < remaining[v]; a++) {
+					unsigned int t = adjacency[adjacencyOffset[v] + a];
+					if (triangleScores[t] > bestScore) {
+						bestScore = triangleScores[t];
+						bestTriangle = (long)t;
+					}
+				}
+
+			if (nextCache.size() > (size_t)CACHE_SIZE)
+				nextCache.resize(CACHE_SIZE);
+			std::swap(cache, nextCache);
+		}
+	}
+
+	// ---- 2. overdraw order ---------------------------------------------------------------
+
+	// Splits a cache optimized index list into clusters and reorders the clusters so that the
+	// ones facing away from the mesh center come first: they are the most likely to occlude the
+	// rest, so early-z rejects more fragments. A cluster ends where the cache order restarted
+	// (a triangle that missed on all three vertices), or at a miss once the cluster is long
+	// enough that refilling the cache after it costs at most (threshold - 1) of the mesh ACMR.
+	// positions is read with the given stride in bytes, destination may not alias indices.
+	inline void optimizeOverdraw(unsigned int* destination, const unsigned int* indices, size_t indexCount,
+		const float* positions, size_t vertexCount, size_t positionStride, float threshold = 1.05f)
+	{
+		size_t triangleCount = indexCount / 3;
+		if (triangleCount == 0)
+			return;
+
+		auto position = [&](unsigned int index) {
+			const float* p = (const float*)((const char*)positions + index * positionStride);
+			return glm::vec3(p[0], p[1], p[2]);
+		};
+
+		// cache misses per triangle, same FIFO as analyzeVertexCache
+		std::vector<unsigned int> loadedAt(vertexCount, 0);
+		std::vector<bool> referenced(vertexCount, false);
+		std::vector<unsigned char> triangleMisses(triangleCount, 0);
+		unsigned int misses = 0;
+		for (size_t t = 0; t < triangleCount; t++)
+			for (int k = 0; k < 3; k++) {
+				unsigned int index = indices[t * 3 + k];
+				if (referenced[index] && misses - loadedAt[index] < ANALYZE_CACHE_SIZE)
+					continue;
+				referenced[index] = true;
+				loadedAt[index] = misses;
+				misses++;
+				triangleMisses[t]++;
+			}
+		float meshAcmr = (float)misses / (float)triangleCount;
+
+		// a cut costs up to a full cache of extra misses once the clusters are moved apart
+		float allowedExtra = (threshold - 1.0f) * meshAcmr;
+		size_t minClusterSize = allowedExtra > 0.0f ? (size_t)((float)ANALYZE_CACHE_SIZE / allowedExtra) : triangleCount;
+
+		// cluster start triangles
+		std::vector<size_t> clusters;
+		for (size_t t = 0; t < triangleCount; t++) {
+			size_t clusterSize = clusters.empty() ? 0 : t - clusters.back();
+			bool hardBoundary = triangleMisses[t] == 3;
+			bool softBoundary = triangleMisses[t] > 0 && clusterSize >= minClusterSize;
+			if (clusters.empty() || hardBoundary || softBoundary)
+				clusters.push_back(t);
+		}
+
+		// area weighted centroid of the mesh
+		glm::vec3 meshCenter(0.0f);
+		float meshArea = 0.0f;
+		for (size_t t = 0; t < triangleCount; t++) {
+			glm::vec3 a = position(indices[t * 3]), b = position(indices[t * 3 + 1]), c = position(indices[t * 3 + 2]);
+			float area = glm::length(glm::cross(b - a, c - a));
+			meshCenter += (a + b + c) * (area / 3.0f);
+			meshArea += area;
+		}
+		if (meshArea > 0.0f)
+			meshCenter /= meshArea;
+
+		// sort key : how much the cluster faces away from the center
+		struct Cluster { size_t begin, end; float key; };
+		std::vector<Cluster> sorted(clusters.size());
+		for (size_t c = 0; c < clusters.size(); c++) {
+			Cluster& cluster = sorted[c];
+			cluster.begin = clusters[c];
+			cluster.end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+
+			glm::vec3 center(0.0f), normal(0.0f);
+			float area = 0.0f;
+			for (size_t t = cluster.begin; t < cluster.end; t++) {
+				glm::vec3 a = position(indices[t * 3]), b = position(indices[t * 3 + 1]), cc = position(indices[t * 3 + 2]);
+				glm::vec3 n = glm::cross(b - a, cc - a); // length is twice the area
+				float triangleArea = glm::length(n);
+				center += (a + b + cc) * (triangleArea / 3.0f);
+				normal += n;
+				area += triangleArea;
+			}
+			if (area > 0.0f)
+				center /= area;
+			float normalLength = glm::length(normal);
+			cluster.key = normalLength > 0.0f ? glm::dot(center - meshCenter, normal / normalLength) : 0.0f;
+		}
+		std::stable_sort(sorted.begin(), sorted.end(),
+			[](const Cluster& a, const Cluster& b) { return a.key > b.key; });
+
+		size_t out = 0;
+		for (const Cluster& cluster : sorted)
+			for (size_t i = cluster.begin * 3; i < cluster.end * 3; i++)
+				destination[out++] = indices[i];
+	}
+
+	// ---- 3. vertex fetch order -------------------------------------------------------------
+
+	// renumbers vertices in the order the index list first uses them, rewriting indices in place
+	// and dropping vertices nothing references. Returns the new vertex count.
+	template <typename V>
+	size_t optimizeVertexFetch(std::vector<V>& vertices, unsigned int* indices, size_t indexCount)
+	{
+		const unsigned int UNUSED = 0xFFFFFFFFu;
+		std::vector<unsigned int> remap(vertices.size(), UNUSED);
+		std::vector<V> reordered;
+		reordered.reserve(vertices.size());
+		for (size_t i = 0; i < indexCount; i++) {
+			unsigned int& mapped = remap[indices[i]];
+			if (mapped == UNUSED) {
+				mapped = (unsigned int)reordered.size();
+				reordered.push_back(vertices[indices[i]]);
+			}
+			indices[i] = mapped;
+		}
+		vertices.swap(reordered);
+		return vertices.size();
+	}
+
+	// ---- all stages ------------------------------------------------------------------------
+
+	struct Report
+	{
+		CacheStats before;
+		CacheStats after;
+	};
+
+	// runs all three stages, position names the glm::vec3 member of V holding the position
+	template <typename V>
+	Report optimizeMesh(std::vector<V>& vertices, std::vector<unsigned int>& indices, glm::vec3 V::* position)
+	{
+		Report report;
+		if (vertices.empty() || indices.size() < 3)
+			return report;
+		const float* firstPosition = &(vertices[0].*position)[0];
+		report.before = analyzeVertexCache(indices.data(), indices.size(), vertices.size());
+
+		std::vector<unsigned int> cacheOrder(indices.size());
+		optimizeVertexCache(cacheOrder.data(), indices.data(), indices.size(), vertices.size());
+		optimizeOverdraw(indices.data(), cacheOrder.data(), cacheOrder.size(), firstPosition, vertices.size(), sizeof(V));
+		optimizeVertexFetch(vertices, indices.data(), indices.size());
+
+		report.after = analyzeVertexCache(indices.data(), indices.size(), vertices.size());
+		return report;
+	}
+
+	inline void printReport(const Report& report, size_t triangleCount)
+	{
+		std::cout << "[LOG] > mesh optimize : " << triangleCount << " triangles, "
+			<< "ACMR " << report.before.acmr << " -> " << report.after.acmr << ", "
+			<< "ATVR " << report.before.atvr << " -> " << report.after.atvr << ", "
+			<< "vertex shader runs " << report.before.transformedVertices << " -> " << report.after.transformedVertices << std::endl;
+	}
+}
+
+#endif
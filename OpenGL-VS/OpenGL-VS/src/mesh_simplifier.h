@@ -0,0 +1,277 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <queue>
+#include <tuple>
+#include <vector>
+
+// Quadric error metric simplification (Garland / Heckbert) by half-edge collapse: a vertex is
+// merged into one of its neighbours, never moved to a new position, so every level indexes
+// the original vertex buffer and keeps its attributes exactly.
+// Attributes are preserved by construction:
+//   - open borders and attribute seams (one position, several vertices: UV seams, hard
+//     normal edges) are locked, they can receive a collapse but never move
+//   - the cost of a collapse adds the normal and UV difference of the two vertices, scaled
+//     by the edge length, so creases and texture detail go last
+// V needs Position, Normal and TexCoords members like Vertex.
+namespace MeshSimplifier
+{
+	struct Level
+	{
+		std::vector<unsigned int> indices;
+		float error = 0.0f; // object space distance the surface may have moved, 0 for the source
+	};
+
+	// symmetric 4x4 matrix, sum of squared distances to a set of planes
+	struct Quadric
+	{
+		double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+
+		static Quadric fromPlane(const glm::dvec3& n, double d)
+		{
+			Quadric q;
+			q.a2 = n.x * n.x; q.ab = n.x * n.y; q.ac = n.x * n.z; q.ad = n.x * d;
+			q.b2 = n.y * n.y; q.bc = n.y * n.z; q.bd = n.y * d;
+			q.c2 = n.z * n.z; q.cd = n.z * d;
+			q.d2 = d * d;
+			return q;
+		}
+
+		Quadric& operator+=(const Quadric& o)
+		{
+			a2 += o.a2; ab += o.ab; ac += o.ac; ad += o.ad; b2 += o.b2;
+			bc += o.bc; bd += o.bd; c2 += o.c2; cd += o.cd; d2 += o.d2;
+			return *this;
+		}
+
+		double error(const glm::dvec3& p) const
+		{
+			return a2 * p.x * p.x + 2 * ab * p.x * p.y + 2 * ac * p.x * p.z + 2 * ad * p.x
+				+ b2 * p.y * p.y + 2 * bc * p.y * p.z + 2 * bd * p.y
+				+ c2 * p.z * p.z + 2 * cd * p.z + d2;
+		}
+	};
+
+	// weight of the attribute term against the squared position error
+	constexpr double ATTRIBUTE_WEIGHT = 0.5;
+
+	// simplifies until at most targetIndexCount indices are left or the next collapse would move
+	// the surface further than maxError. error receives the largest error accepted.
+	template <typename V>
+	std::vector<unsigned int> simplify(const std::vector<V>& vertices, const std::vector<unsigned int>& indices,
+		size_t targetIndexCount, float maxError, float* error = nullptr)
+	{
+		const size_t vertexCount = vertices.size();
+		const size_t triangleCount = indices.size() / 3;
+		std::vector<unsigned int> tris(indices.begin(), indices.begin() + triangleCount * 3);
+		std::vector<bool> alive(triangleCount, true);
+
+		auto position = [&](unsigned int v) { return glm::dvec3(vertices[v].Position); };
+
+		// ---- locked vertices : seams and borders
+		std::vector<bool> locked(vertexCount, false);
+		{
+			std::map<std::tuple<float, float, float>, unsigned int> firstAtPosition;
+			std::vector<unsigned int> canonical(vertexCount);
+			for (size_t v = 0; v < vertexCount; v++) {
+				const glm::vec3& p = vertices[v].Position;
+				auto inserted = firstAtPosition.emplace(std::make_tuple(p.x, p.y, p.z), (unsigned int)v);
+				canonical[v] = inserted.first->second;
+				if (!inserted.second)
+					locked[v] = locked[canonical[v]] = true;
+			}
+
+			std::map<std::pair<unsigned int, unsigned int>, int> edgeUse;
+			for (size_t t = 0; t < triangleCount; t++)
+				for (int k = 0; k < 3; k++) {
+					unsigned int a = tris[t * 3 + k], b = tris[t * 3 + (k + 1) % 3];
+					edgeUse[std::make_pair(std::min(a, b), std::max(a, b))]++;
+				}
+			for (const auto& edge : edgeUse)
+				if (edge.second == 1)
+					locked[edge.first.first] = locked[edge.first.second] = true;
+		}
+
+		// ---- quadrics and adjacency
+		std::vector<Quadric> quadrics(vertexCount);
+		std::vector<std::vector<unsigned int>> vertexTriangles(vertexCount);
+		for (size_t t = 0; t < triangleCount; t++) {
+			unsigned int i0 = tris[t * 3], i1 = tris[t * 3 + 1], i2 = tris[t * 3 + 2];
+			glm::dvec3 n = glm::cross(position(i1) - position(i0), position(i2) - position(i0));
+			double length = glm::length(n);
+			if (length > 0.0) {
+				n /= length;
+				Quadric q = Quadric::fromPlane(n, -glm::dot(n, position(i0)));
+				quadrics[i0] += q;
+				quadrics[i1] += q;
+				quadrics[i2] += q;
+			}
+			vertexTriangles[i0].push_back((unsigned int)t);
+			vertexTriangles[i1].push_back((unsigned int)t);
+			vertexTriangles[i2].push_back((unsigned int)t);
+		}
+
+		auto neighbours = [&](unsigned int u, std::vector<unsigned int>& out) {
+			out.clear();
+			for (unsigned int t : vertexTriangles[u]) {
+				if (!alive[t])
+					continue;
+				for (int k = 0; k < 3; k++) {
+					unsigned int v = tris[t * 3 + k];
+					if (v != u && std::find(out.begin(), out.end(), v) == out.end())
+						out.push_back(v);
+				}
+			}
+		};
+
+		// moving u onto v must not turn any remaining triangle of u over
+		auto flips = [&](unsigned int u, unsigned int v) {
+			for (unsigned int t : vertexTriangles[u]) {
+				if (!alive[t])
+					continue;
+				unsigned int* tri = &tris[t * 3];
+				if (tri[0] == v || tri[1] == v || tri[2] == v)
+					continue; // collapses away
+				glm::dvec3 p[3], q[3];
+				for (int k = 0; k < 3; k++) {
+					p[k] = position(tri[k]);
+					q[k] = tri[k] == u ? position(v) : p[k];
+				}
+				glm::dvec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+				glm::dvec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+				if (glm::dot(before, after) <= 0.0)
+					return true;
+			}
+			return false;
+		};
+
+		auto cost = [&](unsigned int u, unsigned int v) {
+			Quadric q = quadrics[u];
+			q += quadrics[v];
+			double positionError = std::max(q.error(position(v)), 0.0);
+			glm::dvec3 edge = position(u) - position(v);
+			glm::dvec3 normalDelta = glm::dvec3(vertices[u].Normal - vertices[v].Normal);
+			glm::dvec2 uvDelta = glm::dvec2(vertices[u].TexCoords - vertices[v].TexCoords);
+			double attributeError = glm::dot(normalDelta, normalDelta) + glm::dot(uvDelta, uvDelta);
+			return positionError + ATTRIBUTE_WEIGHT * attributeError * glm::dot(edge, edge);
+		};
+
+		// best collapse per vertex, stale entries are recognized by their stamp
+		struct Candidate
+		{
+			double cost;
+			unsigned int u, v, stamp;
+			bool operator<(const Candidate& o) const { return cost > o.cost; }
+		};
+		std::priority_queue<Candidate> queue;
+		std::vector<unsigned int> stamps(vertexCount, 0);
+		std::vector<unsigned int> scratch;
+
+		auto evaluate = [&](unsigned int u) {
+			stamps[u]++;
+			if (locked[u])
+				return;
+			neighbours(u, scratch);
+			double best = 0.0;
+			long target = -1;
+			for (unsigned int v : scratch) {
+				double c = cost(u, v);
+				if ((target < 0 || c < best) && !flips(u, v)) {
+					best = c;
+					target = v;
+				}
+			}
+			if (target >= 0)
+				queue.push(Candidate{ best, u, (unsigned int)target, stamps[u] });
+		};
+
+		for (unsigned int u = 0; u < vertexCount; u++)
+			if (!vertexTriangles[u].empty())
+				evaluate(u);
+
+		size_t indexCount = triangleCount * 3;
+		double maxCost = (double)maxError * (double)maxError;
+		double acceptedCost = 0.0;
+		while (indexCount > targetIndexCount && !queue.empty()) {
+			Candidate candidate = queue.top();
+			queue.pop();
+			if (candidate.stamp != stamps[candidate.u])
+				continue;
+			if (candidate.cost > maxCost)
+				break;
+			unsigned int u = candidate.u, v = candidate.v;
+			if (flips(u, v)) {
+				evaluate(u);
+				continue;
+			}
+
+			// u joins v : triangles on the edge disappear, the others switch over
+			for (unsigned int t : vertexTriangles[u]) {
+				if (!alive[t])
+					continue;
+				unsigned int* tri = &tris[t * 3];
+				if (tri[0] == v || tri[1] == v || tri[2] == v) {
+					alive[t] = false;
+					indexCount -= 3;
+					continue;
+				}
+				for (int k = 0; k < 3; k++)
+					if (tri[k] == u)
+						tri[k] = v;
+				vertexTriangles[v].push_back(t);
+			}
+			vertexTriangles[u].clear();
+			quadrics[v] += quadrics[u];
+			stamps[u]++;
+			acceptedCost = std::max(acceptedCost, candidate.cost);
+
+			// every collapse touching v changed cost
+			std::vector<unsigned int> around;
+			neighbours(v, around);
+			evaluate(v);
+			for (unsigned int w : around)
+				evaluate(w);
+		}
+
+		std::vector<unsigned int> result;
+		result.reserve(indexCount);
+		for (size_t t = 0; t < triangleCount; t++)
+			if (alive[t])
+				result.insert(result.end(), tris.begin() + t * 3, tris.begin() + t * 3 + 3);
+		if (error)
+			*error = (float)std::sqrt(acceptedCost);
+		return result;
+	}
+
+	// Level 0 is the source, each further level aims for reduction times the index count of
+	// the one before. Generation stops early once a level no longer shrinks by at least 10%
+	// (everything left is locked or would flip).
+	template <typename V>
+	std::vector<Level> generateLodChain(const std::vector<V>& vertices, const std::vector<unsigned int>& indices,
+		int extraLevels, float reduction = 0.5f, float maxError = 1e30f)
+	{
+		std::vector<Level> chain(1);
+		chain[0].indices = indices;
+		for (int level = 1; level <= extraLevels; level++) {
+			const Level& previous = chain.back();
+			size_t target = (size_t)((float)previous.indices.size() * reduction) / 3 * 3;
+			Level next;
+			// always from the source, so the error of the level is measured against it
+			next.indices = simplify(vertices, indices, target, maxError, &next.error);
+			if (next.indices.empty() || (float)next.indices.size() > (float)previous.indices.size() * 0.9f)
+				break;
+			next.error = std::max(next.error, previous.error);
+			chain.push_back(std::move(next));
+		}
+		return chain;
+	}
+}
+
+#endif
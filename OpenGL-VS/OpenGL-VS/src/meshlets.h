@@ -0,0 +1,176 @@
+#ifndef MESHLETS_H
+#define MESHLETS_H
+
+#include <glm/glm.hpp>
+
+#include "frustum_culling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// A small cluster of a mesh's triangles, contiguous in its index buffer, with the bounds
+// needed to drop the whole cluster on the CPU before the GPU ever sees it.
+struct Meshlet
+{
+	unsigned int indexOffset = 0;   // first index in the mesh's index list
+	unsigned int triangleCount = 0;
+	// object space bounding sphere
+	glm::vec3 center = glm::vec3(0.0f);
+	float radius = 0.0f;
+	// every triangle normal lies within the cone around axis, cutoff 1 when the spread is too
+	// wide for the cluster to ever be entirely back facing
+	glm::vec3 coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+	float coneCutoff = 1.0f;
+};
+
+namespace Meshlets
+{
+	constexpr size_t MAX_VERTICES = 64;
+	constexpr size_t MAX_TRIANGLES = 124;
+
+	// Splits indices into meshlets of at most maxVertices distinct vertices and maxTriangles
+	// triangles, in index order: run it after MeshOptimizer::optimizeVertexCache and the
+	// clusters come out as compact patches. The index list is not changed, every meshlet is
+	// a range of it. positions is read with the given stride in bytes.
+	inline std::vector<Meshlet> build(const unsigned int* indices, size_t indexCount, const float* positions, size_t vertexCount,
+		size_t positionStride, size_t maxVertices = MAX_VERTICES, size_t maxTriangles = MAX_TRIANGLES)
+	{
+		auto position = [&](unsigned int index) {
+			const float* p = (const float*)((const char*)positions + index * positionStride);
+			return glm::vec3(p[0], p[1], p[2]);
+		};
+
+		std::vector<Meshlet> meshlets;
+		// which meshlet last used a vertex, to count the distinct vertices of the open one
+		std::vector<unsigned int> usedBy(vertexCount, 0xFFFFFFFFu);
+		std::vector<unsigned int> clusterVertices;
+
+		auto finish = [&](Meshlet& meshlet) {
+			// bounding sphere around the box of the vertices
+			glm::vec3 lo = position(clusterVertices[0]), hi = lo;
+			for (unsigned int v : clusterVertices) {
+				lo = glm::min(lo, position(v));
+				hi = glm::max(hi, position(v));
+			}
+			meshlet.center = (lo + hi) * 0.5f;
+			meshlet.radius = 0.0f;
+			for (unsigned int v : clusterVertices)
+				meshlet.radius = std::max(meshlet.radius, glm::length(position(v) - meshlet.center));
+
+			// normal cone, axis is the area weighted mean normal
+			glm::vec3 axis(0.0f);
+			const unsigned int* tri = indices + meshlet.indexOffset;
+			for (unsigned int t = 0; t < meshlet.triangleCount; t++, tri += 3)
+				axis += glm::cross(position(tri[1]) - position(tri[0]), position(tri[2]) - position(tri[0]));
+			float axisLength = glm::length(axis);
+			if (axisLength <= 0.0f)
+				return;
+			axis /= axisLength;
+
+			float minDot = 1.0f;
+			tri = indices + meshlet.indexOffset;
+			for (unsigned int t = 0; t < meshlet.triangleCount; t++, tri += 3) {
+				glm::vec3 n = glm::cross(position(tri[1]) - position(tri[0]), position(tri[2]) - position(tri[0]));
+				float length = glm::length(n);
+				if (length > 0.0f)
+					minDot = std::min(minDot, glm::dot(axis, n / length));
+			}
+			meshlet.coneAxis = axis;
+			// a cone of 90 degrees or more always has a front facing triangle for some view
+			meshlet.coneCutoff = minDot <= 0.0f ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+		};
+
+		Meshlet current;
+		for (size_t i = 0; i + 2 < indexCount; i += 3) {
+			size_t newVertices = 0;
+			for (int k = 0; k < 3; k++)
+				if (usedBy[indices[i + k]] != meshlets.size())
+					newVertices++;
+
+			if (current.triangleCount > 0 &&
+				(clusterVertices.size() + newVertices > maxVertices || current.triangleCount + 1 > maxTriangles)) {
+				finish(current);
+				meshlets.push_back(current);
+				current = Meshlet();
+				current.indexOffset = (unsigned int)i;
+				clusterVertices.clear();
+			}
+
+			for (int k = 0; k < 3; k++) {
+				unsigned int v = indices[i + k];
+				if (usedBy[v] != meshlets.size()) {
+					usedBy[v] = (unsigned int)meshlets.size();
+					clusterVertices.push_back(v);
+				}
+			}
+			current.triangleCount++;
+		}
+		if (current.triangleCount > 0) {
+			finish(current);
+			meshlets.push_back(current);
+		}
+		return meshlets;
+	}
+
+	// true when no triangle of the meshlet can face the camera (object space position)
+	inline bool backFacing(const Meshlet& meshlet, const glm::vec3& cameraPosition)
+	{
+		glm::vec3 toCenter = meshlet.center - cameraPosition;
+		return glm::dot(toCenter, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius;
+	}
+
+	inline bool outside(const Meshlet& meshlet, const Frustum& frustum)
+	{
+		for (const glm::vec4& plane : frustum.planes)
+			if (glm::dot(glm::vec3(plane), meshlet.center) + plane.w < -meshlet.radius)
+				return true;
+		return false;
+	}
+
+	struct CullStats
+	{
+		unsigned int total = 0;
+		unsigned int frustumCulled = 0;
+		unsigned int backfaceCulled = 0;
+		unsigned int ranges = 0; // draws left after merging neighbouring survivors
+	};
+
+	// Culls the meshlets and writes the surviving index ranges for glMultiDrawElements, with
+	// neighbours in the index buffer merged into one range. frustum and cameraPosition are in
+	// the mesh's object space (Frustum::fromMatrix(viewProjection * model), inverse(model) *
+	// camera position), which holds while the model matrix has a uniform scale.
+	inline CullStats cull(const std::vector<Meshlet>& meshlets, const Frustum& frustum, const glm::vec3& cameraPosition,
+		size_t indexSize, std::vector<int>& counts, std::vector<const void*>& offsets)
+	{
+		CullStats stats;
+		stats.total = (unsigned int)meshlets.size();
+		counts.clear();
+		offsets.clear();
+
+		size_t rangeEnd = (size_t)-1;
+		for (const Meshlet& meshlet : meshlets) {
+			if (outside(meshlet, frustum)) {
+				stats.frustumCulled++;
+				continue;
+			}
+			if (backFacing(meshlet, cameraPosition)) {
+				stats.backfaceCulled++;
+				continue;
+			}
+			int indexCount = (int)meshlet.triangleCount * 3;
+			if (meshlet.indexOffset == rangeEnd)
+				counts.back() += indexCount;
+			else {
+				counts.push_back(indexCount);
+				offsets.push_back((const void*)(meshlet.indexOffset * indexSize));
+			}
+			rangeEnd = meshlet.indexOffset + (size_t)indexCount;
+		}
+		stats.ranges = (unsigned int)counts.size();
+		return stats;
+	}
+}
+
+#endif
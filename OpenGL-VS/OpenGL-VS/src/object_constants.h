@@ -0,0 +1,113 @@
+#ifndef OBJECT_CONSTANTS_H
+#define OBJECT_CONSTANTS_H
+
+#include <glad/glad.h> // include glad to get all the required OpenGL headers
+
+#include <glm/glm.hpp>
+
+#include "shaders/shader_s.h"
+#include "shaders/generated/shader_reflection.h"
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+// C++ mirror of the std140 "Object" block in basic_lighting.vs / light_cube.vs
+struct ObjectConstantsStd140 {
+	glm::mat4 model;
+	glm::mat4 normalMatrix; // transpose(inverse(model)) padded to a mat4, std140 mat3 columns are vec4 anyway
+};
+
+static_assert(sizeof(ObjectConstantsStd140) == 128, "Object block does not match std140");
+static_assert(sizeof(ObjectConstantsStd140) == ShaderReflection::ObjectBlock::size, "Object block differs from the shaders");
+static_assert(offsetof(ObjectConstantsStd140, normalMatrix) == ShaderReflection::ObjectBlock::normalMatrix, "Object block differs from the shaders");
+
+// Per-frame buffer holding the constants of every object drawn in the frame.
+// Objects are pushed into a CPU staging copy, upload() sends the whole frame in one
+// transfer and bind() points the "Object" block at one object's slice with glBindBufferRange.
+class ObjectConstantsBuffer
+{
+public:
+	// binding point of the "Object" block
+	static const unsigned int BINDING = 1;
+
+	void create(unsigned int initialCapacity)
+	{
+		// slices handed to glBindBufferRange must start at a multiple of this
+		GLint alignment = 256;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		stride = (sizeof(ObjectConstantsStd140) + alignment - 1) / alignment * alignment;
+
+		capacity = initialCapacity > 0 ? initialCapacity : 1;
+		staging.resize(capacity * stride);
+		glGenBuffers(1, &ubo);
+		glState.bindBuffer(GL_UNIFORM_BUFFER, ubo);
+		glBufferData(GL_UNIFORM_BUFFER, staging.size(), nullptr, GL_STREAM_DRAW);
+		count = 0;
+	}
+
+	void destroy()
+	{
+		glState.forgetBuffer(ubo);
+		glDeleteBuffers(1, &ubo);
+		ubo = 0;
+	}
+
+	// connects the program's "Object" block to the shared binding point
+	void attach(Shader& shader) const
+	{
+		shader.bindUniformBlock("Object", BINDING);
+	}
+
+	// starts a new frame
+	void begin()
+	{
+		count = 0;
+	}
+
+	// appends one object and returns its slot for bind()
+	unsigned int push(const glm::mat4& model)
+	{
+		if (count == capacity) {
+			capacity *= 2;
+			staging.resize(capacity * stride);
+		}
+
+		ObjectConstantsStd140 constants;
+		constants.model = model;
+		constants.normalMatrix = glm::mat4(glm::transpose(glm::inverse(glm::mat3(model))));
+		std::memcpy(staging.data() + count * stride, &constants, sizeof(constants));
+		return count++;
+	}
+
+	// objects pushed so far this frame, the slot the next push() returns
+	unsigned int size() const
+	{
+		return count;
+	}
+
+	// sends every object of the frame in one transfer
+	void upload()
+	{
+		glState.bindBuffer(GL_UNIFORM_BUFFER, ubo);
+		// orphan last frame's storage (growing it if needed) so we never wait for draws still reading it
+		glBufferData(GL_UNIFORM_BUFFER, staging.size(), nullptr, GL_STREAM_DRAW);
+		if (count > 0)
+			glBufferSubData(GL_UNIFORM_BUFFER, 0, count * stride, staging.data());
+	}
+
+	// selects the slice read by the next draw
+	void bind(unsigned int slot) const
+	{
+		glState.bindBufferRange(GL_UNIFORM_BUFFER, BINDING, ubo, slot * stride, sizeof(ObjectConstantsStd140));
+	}
+
+private:
+	unsigned int ubo = 0;
+	std::size_t stride = sizeof(ObjectConstantsStd140);
+	unsigned int capacity = 0;
+	unsigned int count = 0;
+	std::vector<unsigned char> staging;
+};
+
+#endif
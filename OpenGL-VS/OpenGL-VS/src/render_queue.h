@@ -0,0 +1,170 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+// Every draw of a frame as one 64-bit key plus a payload (whatever the caller needs to issue
+// it, an object index). Sorting the keys orders the frame by state, most expensive change
+// first, and within one state opaque draws front to back for early-Z:
+//
+//   63     60 59        48 47             32 31       24 23             0
+//   [ pass ] [ program  ] [   material     ] [  vao    ] [    depth     ]
+//      4          12             16              8            24
+//
+// Program, material and vertex array are small IDs chosen by the caller, not GL names.
+// Depth is quantized view depth, inverted for the transparent pass so it sorts back to front.
+// Items with the same key above the depth bits form a run: they share every state and can be
+// issued together (one instanced draw, one multi-draw).
+class RenderQueue
+{
+public:
+	enum Pass { PASS_OPAQUE = 0, PASS_TRANSPARENT = 1 };
+
+	static constexpr int DEPTH_BITS = 24;
+	static constexpr int VERTEX_ARRAY_BITS = 8;
+	static constexpr int MATERIAL_BITS = 16;
+	static constexpr int PROGRAM_BITS = 12;
+	static constexpr int PASS_BITS = 4;
+
+	static constexpr int VERTEX_ARRAY_SHIFT = DEPTH_BITS;
+	static constexpr int MATERIAL_SHIFT = VERTEX_ARRAY_SHIFT + VERTEX_ARRAY_BITS;
+	static constexpr int PROGRAM_SHIFT = MATERIAL_SHIFT + MATERIAL_BITS;
+	static constexpr int PASS_SHIFT = PROGRAM_SHIFT + PROGRAM_BITS;
+	static_assert(PASS_SHIFT + PASS_BITS == 64, "sort key fields must fill 64 bits");
+
+	struct Item
+	{
+		uint64_t key;
+		uint32_t payload;
+	};
+
+	// consecutive items sharing everything but depth
+	struct Run
+	{
+		uint64_t state; // key with the depth bits cleared
+		unsigned int first;
+		unsigned int count;
+	};
+
+	// state switches a list of items costs when drawn in order, one per field that differs
+	// from the item before (the first item counts as a switch of everything)
+	struct StateChanges
+	{
+		unsigned int passes = 0;
+		unsigned int programs = 0;
+		unsigned int materials = 0;
+		unsigned int vertexArrays = 0;
+
+		unsigned int total() const { return passes + programs + materials + vertexArrays; }
+	};
+
+	// viewDepth : distance along the view axis, clamped to [0, zFar]
+	static uint64_t makeKey(Pass pass, unsigned int program, unsigned int material, unsigned int vertexArray, float viewDepth, float zFar)
+	{
+		const uint32_t depthMax = (1u << DEPTH_BITS) - 1;
+		float normalized = std::min(std::max(viewDepth / zFar, 0.0f), 1.0f);
+		uint32_t depth = (uint32_t)(normalized * (float)depthMax);
+		if (pass == PASS_TRANSPARENT)
+			depth = depthMax - depth;
+		return (uint64_t)pass << PASS_SHIFT
+			| (uint64_t)(program & ((1u << PROGRAM_BITS) - 1)) << PROGRAM_SHIFT
+			| (uint64_t)(material & ((1u << MATERIAL_BITS) - 1)) << MATERIAL_SHIFT
+			| (uint64_t)(vertexArray & ((1u << VERTEX_ARRAY_BITS) - 1)) << VERTEX_ARRAY_SHIFT
+			| depth;
+	}
+
+	static unsigned int pass(uint64_t key) { return (unsigned int)(key >> PASS_SHIFT) & ((1u << PASS_BITS) - 1); }
+	static unsigned int program(uint64_t key) { return (unsigned int)(key >> PROGRAM_SHIFT) & ((1u << PROGRAM_BITS) - 1); }
+	static unsigned int material(uint64_t key) { return (unsigned int)(key >> MATERIAL_SHIFT) & ((1u << MATERIAL_BITS) - 1); }
+	static unsigned int vertexArray(uint64_t key) { return (unsigned int)(key >> VERTEX_ARRAY_SHIFT) & ((1u << VERTEX_ARRAY_BITS) - 1); }
+
+	// starts a new frame
+	void begin()
+	{
+		items.clear();
+		runs.clear();
+	}
+
+	void push(uint64_t key, uint32_t payload)
+	{
+		items.push_back(Item{ key, payload });
+	}
+
+	// Orders the items by key (stable LSD radix sort, one pass per key byte that is not the
+	// same for every item) and groups them into runs. unsorted receives what drawing them in
+	// push order would have cost.
+	void sort(StateChanges* unsorted = nullptr)
+	{
+		if (unsorted)
+			*unsorted = countStateChanges(items);
+
+		size_t count = items.size();
+		scratch.resize(count);
+		size_t histograms[8][256] = {};
+		for (const Item& item : items)
+			for (int digit = 0; digit < 8; digit++)
+				histograms[digit][(item.key >> (digit * 8)) & 0xFF]++;
+
+		for (int digit = 0; digit < 8; digit++) {
+			size_t* histogram = histograms[digit];
+			// a byte every key shares does not change the order
+			if (count == 0 || histogram[(items[0].key >> (digit * 8)) & 0xFF] == count)
+				continue;
+			size_t offset = 0;
+			for (int bucket = 0; bucket < 256; bucket++) {
+				size_t size = histogram[bucket];
+				histogram[bucket] = offset;
+				offset += size;
+			}
+			for (const Item& item : items)
+				scratch[histogram[(item.key >> (digit * 8)) & 0xFF]++] = item;
+			items.swap(scratch);
+		}
+
+		runs.clear();
+		const uint64_t stateMask = ~(uint64_t)0 << DEPTH_BITS;
+		for (unsigned int i = 0; i < count; i++) {
+			uint64_t state = items[i].key & stateMask;
+			if (runs.empty() || runs.back().state != state)
+				runs.push_back(Run{ state, i, 0 });
+			runs.back().count++;
+		}
+	}
+
+	const std::vector<Item>& getItems() const { return items; }
+	// valid after sort()
+	const std::vector<Run>& getRuns() const { return runs; }
+	size_t size() const { return items.size(); }
+
+	static StateChanges countStateChanges(const std::vector<Item>& list)
+	{
+		StateChanges changes;
+		for (size_t i = 0; i < list.size(); i++) {
+			uint64_t key = list[i].key;
+			bool first = i == 0;
+			uint64_t previous = first ? 0 : list[i - 1].key;
+			changes.passes += first || pass(key) != pass(previous);
+			changes.programs += first || program(key) != program(previous);
+			changes.materials += first || material(key) != material(previous);
+			changes.vertexArrays += first || vertexArray(key) != vertexArray(previous);
+		}
+		return changes;
+	}
+
+	static void printStateChanges(const char* label, const StateChanges& changes)
+	{
+		std::cout << label << changes.total() << " (pass " << changes.passes << ", program " << changes.programs
+			<< ", material " << changes.materials << ", vao " << changes.vertexArrays << ")";
+	}
+
+private:
+	std::vector<Item> items;
+	std::vector<Item> scratch;
+	std::vector<Run> runs;
+};
+
+#endif
@@ -1,20 +1,82 @@
 #version 330 core
+
+// Permutation switches, injected by the shader loader. These are the defaults when nothing is injected.
+#ifndef QUANTIZED_VERTICES
+#define QUANTIZED_VERTICES 0
+#endif
+#ifndef MULTI_DRAW
+#define MULTI_DRAW 0
+#endif
+#ifndef INSTANCED
+#define INSTANCED 0
+#endif
+
+#if QUANTIZED_VERTICES
+// packed QuantizedVertex (vertex_quantization.h), the fetch already normalizes / converts
+layout (location = 0) in vec3 aPackedPos;    // unorm16, 0..1 across the mesh bounds
+layout(location = 1) in vec2 aPackedNormal;  // octahedral, snorm16
+layout(location = 2) in vec2 aTexCoords;     // half float
+#else
 layout (location = 0) in vec3 aPos;
 layout(location = 1) in vec3 aNormal;
 layout(location = 2) in vec2 aTexCoords;
+#endif
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoords;
 
-uniform mat4 model; // Model matrix	
+#if INSTANCED
+// per-instance matrices (InstanceData, instance_buffer.h), divisor 1
+layout(location = 4) in mat4 aModel;
+layout(location = 8) in mat3 aNormalMatrix;
+#elif MULTI_DRAW
+#include "include/draw_data.glsl"
+#else
+// per-object constants, one slice of the frame's object buffer (ObjectConstantsStd140)
+layout (std140) uniform Object {
+	mat4 model; // Model matrix
+	mat4 normalMatrix; // transpose(inverse(model)), computed on the CPU
+};
+#endif
 uniform mat4 view; // View matrix
 uniform mat4 projection; // Projection matrix
 
+#if QUANTIZED_VERTICES
+#if !MULTI_DRAW
+uniform vec3 positionOffset; // mesh bounds minimum
+uniform vec3 positionScale;  // mesh bounds extent
+#endif
+
+vec3 octDecode(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+	return normalize(n);
+}
+#endif
+
 void main()
 {
+#if INSTANCED
+	mat4 model = aModel;
+	mat3 normalMatrix = aNormalMatrix;
+#elif MULTI_DRAW
+	DrawConstants object = FetchDrawConstants();
+	mat4 model = object.model;
+	mat4 normalMatrix = object.normalMatrix;
+#endif
+#if QUANTIZED_VERTICES && MULTI_DRAW
+	vec3 aPos = aPackedPos; // the draw's model matrix already maps the mesh bounds
+#elif QUANTIZED_VERTICES
+	vec3 aPos = aPackedPos * positionScale + positionOffset;
+#endif
+#if QUANTIZED_VERTICES
+	vec3 aNormal = octDecode(aPackedNormal);
+#endif
 	FragPos = vec3(model * vec4(aPos, 1.0));
-	Normal = mat3(transpose(inverse(model))) * aNormal;
+	Normal = mat3(normalMatrix) * aNormal;
 	TexCoords = aTexCoords;
 
 	gl_Position = projection * view * model * vec4(aPos, 1.0);
@@ -0,0 +1,314 @@
+// Generated by tools/embed_shaders.py from src/shaders, do not edit.
+#ifndef EMBEDDED_SHADERS_H
+#define EMBEDDED_SHADERS_H
+
+#include <string_view>
+
+namespace EmbeddedShaders
+{
+
+struct File
+{
+	std::string_view path;
+	std::string_view source;
+};
+
+inline constexpr File files[] = {
+	{ "src/shaders/basic_lighting.fs",
+		R"glsl(#version 330 core
+out vec4 FragColor;
+#ifndef NR_POINT_LIGHTS
+#define NR_POINT_LIGHTS 4
+#endif
+#ifndef USE_SPOTLIGHT
+#define USE_SPOTLIGHT 1
+#endif
+#ifndef HAS_SPECULAR_MAP
+#define HAS_SPECULAR_MAP 1
+#endif
+#include "include/material.glsl"
+#include "include/lights.glsl"
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+uniform vec3 viewPos;
+uniform Material material;
+void main()
+{
+vec3 norm = normalize(Normal);
+vec3 viewDir = normalize(viewPos - FragPos);
+MaterialSample m = SampleMaterial(material, TexCoords);
+vec3 result = CalcDirLight(dirLight, m, norm, viewDir);
+for(int i = 0; i < NR_POINT_LIGHTS; i++)
+result += CalcPointLight(pointLights[i], m, norm, FragPos, viewDir);
+#if USE_SPOTLIGHT
+result += CalcSpotLight(spotLight, m, norm, FragPos, viewDir);
+#endif
+FragColor = vec4(result, 1.0);
+}
+)glsl" },
+	{ "src/shaders/basic_lighting.vs",
+		R"glsl(#version 330 core
+#ifndef QUANTIZED_VERTICES
+#define QUANTIZED_VERTICES 0
+#endif
+#ifndef MULTI_DRAW
+#define MULTI_DRAW 0
+#endif
+#ifndef INSTANCED
+#define INSTANCED 0
+#endif
+#if QUANTIZED_VERTICES
+layout (location = 0) in vec3 aPackedPos;
+layout(location = 1) in vec2 aPackedNormal;
+layout(location = 2) in vec2 aTexCoords;
+#else
+layout (location = 0) in vec3 aPos;
+layout(location = 1) in vec3 aNormal;
+layout(location = 2) in vec2 aTexCoords;
+#endif
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+#if INSTANCED
+layout(location = 4) in mat4 aModel;
+layout(location = 8) in mat3 aNormalMatrix;
+#elif MULTI_DRAW
+#include "include/draw_data.glsl"
+#else
+layout (std140) uniform Object {
+mat4 model;
+mat4 normalMatrix;
+};
+#endif
+uniform mat4 view;
+uniform mat4 projection;
+#if QUANTIZED_VERTICES
+#if !MULTI_DRAW
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+#endif
+vec3 octDecode(vec2 e)
+{
+vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+float t = max(-n.z, 0.0);
+n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+return normalize(n);
+}
+#endif
+void main()
+{
+#if INSTANCED
+mat4 model = aModel;
+mat3 normalMatrix = aNormalMatrix;
+#elif MULTI_DRAW
+DrawConstants object = FetchDrawConstants();
+mat4 model = object.model;
+mat4 normalMatrix = object.normalMatrix;
+#endif
+#if QUANTIZED_VERTICES && MULTI_DRAW
+vec3 aPos = aPackedPos;
+#elif QUANTIZED_VERTICES
+vec3 aPos = aPackedPos * positionScale + positionOffset;
+#endif
+#if QUANTIZED_VERTICES
+vec3 aNormal = octDecode(aPackedNormal);
+#endif
+FragPos = vec3(model * vec4(aPos, 1.0));
+Normal = mat3(normalMatrix) * aNormal;
+TexCoords = aTexCoords;
+gl_Position = projection * view * model * vec4(aPos, 1.0);
+}
+)glsl" },
+	{ "src/shaders/fragmentShader.fs",
+		R"glsl(#version 330 core
+out vec4 FragColor;
+in vec2 TexCoord;
+uniform sampler2D texture1;
+uniform sampler2D texture2;
+void main() {
+FragColor = mix(texture(texture1, TexCoord), texture(texture2, TexCoord), 0.2);
+}
+)glsl" },
+	{ "src/shaders/light_cube.fs",
+		R"glsl(#version 330 core
+out vec4 FragColor;
+void main()
+{
+FragColor = vec4(1.0);
+}
+)glsl" },
+	{ "src/shaders/light_cube.vs",
+		R"glsl(#version 330 core
+#ifndef MULTI_DRAW
+#define MULTI_DRAW 0
+#endif
+#ifndef INSTANCED
+#define INSTANCED 0
+#endif
+layout(location = 0) in vec3 aPos;
+#if INSTANCED
+layout(location = 4) in mat4 aModel;
+#elif MULTI_DRAW
+#include "include/draw_data.glsl"
+#else
+layout (std140) uniform Object {
+mat4 model;
+mat4 normalMatrix;
+};
+#endif
+uniform mat4 view;
+uniform mat4 projection;
+void main()
+{
+#if INSTANCED
+mat4 model = aModel;
+#elif MULTI_DRAW
+mat4 model = FetchDrawConstants().model;
+#endif
+gl_Position = projection * view * model * vec4(aPos, 1.0);
+}
+)glsl" },
+	{ "src/shaders/vertexShader.vs",
+		R"glsl(#version 330 core
+layout (location = 0) in vec3 aPos;
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+void main(){
+gl_Position = projection * view * model * vec4(aPos, 1.0);
+}
+)glsl" },
+	{ "src/shaders/include/draw_data.glsl",
+		R"glsl(layout(location = 3) in uint aDrawID;
+uniform samplerBuffer drawData;
+uniform int drawIdBase;
+struct DrawConstants {
+mat4 model;
+mat4 normalMatrix;
+};
+DrawConstants FetchDrawConstants()
+{
+int texel = (int(aDrawID) + drawIdBase) * 8;
+DrawConstants c;
+c.model = mat4(texelFetch(drawData, texel), texelFetch(drawData, texel + 1),
+texelFetch(drawData, texel + 2), texelFetch(drawData, texel + 3));
+c.normalMatrix = mat4(texelFetch(drawData, texel + 4), texelFetch(drawData, texel + 5),
+texelFetch(drawData, texel + 6), texelFetch(drawData, texel + 7));
+return c;
+}
+)glsl" },
+	{ "src/shaders/include/lights.glsl",
+		R"glsl(#define MAX_POINT_LIGHTS 4
+struct DirLight {
+vec3 direction;
+vec3 ambient;
+vec3 diffuse;
+vec3 specular;
+};
+struct PointLight {
+vec3 position;
+float constant;
+vec3 ambient;
+float linear;
+vec3 diffuse;
+float quadratic;
+vec3 specular;
+};
+struct SpotLight {
+vec3 position;
+float cutOff;
+vec3 direction;
+float outerCutOff;
+vec3 ambient;
+float constant;
+vec3 diffuse;
+float linear;
+vec3 specular;
+float quadratic;
+};
+layout (std140) uniform Lights {
+DirLight dirLight;
+PointLight pointLights[MAX_POINT_LIGHTS];
+SpotLight spotLight;
+};
+vec3 CalcDirLight(DirLight light, MaterialSample m, vec3 normal, vec3 viewDir)
+{
+vec3 lightDir = normalize(-light.direction);
+float diff = max(dot(normal, lightDir), 0.0);
+vec3 reflectDir = reflect(-lightDir, normal);
+float spec = pow(max(dot(viewDir, reflectDir), 0.0), m.shininess);
+vec3 ambient = light.ambient * m.diffuse;
+vec3 diffuse = light.diffuse * diff * m.diffuse;
+vec3 specular = light.specular * spec * m.specular;
+return (ambient + diffuse + specular);
+}
+vec3 CalcPointLight(PointLight light, MaterialSample m, vec3 normal, vec3 fragPos, vec3 viewDir)
+{
+vec3 lightDir = normalize(light.position - fragPos);
+float diff = max(dot(normal, lightDir), 0.0);
+vec3 reflectDir = reflect(-lightDir, normal);
+float spec = pow(max(dot(viewDir, reflectDir), 0.0), m.shininess);
+float distance = length(light.position - fragPos);
+float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+vec3 ambient = light.ambient * m.diffuse;
+vec3 diffuse = light.diffuse * diff * m.diffuse;
+vec3 specular = light.specular * spec * m.specular;
+return (ambient + diffuse + specular) * attenuation;
+}
+vec3 CalcSpotLight(SpotLight light, MaterialSample m, vec3 normal, vec3 fragPos, vec3 viewDir)
+{
+vec3 lightDir = normalize(light.position - fragPos);
+float diff = max(dot(normal, lightDir), 0.0);
+vec3 reflectDir = reflect(-lightDir, normal);
+float spec = pow(max(dot(viewDir, reflectDir), 0.0), m.shininess);
+float distance = length(light.position - fragPos);
+float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+float theta = dot(lightDir, normalize(-light.direction));
+float epsilon = light.cutOff - light.outerCutOff;
+float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+vec3 ambient = light.ambient * m.diffuse;
+vec3 diffuse = light.diffuse * diff * m.diffuse;
+vec3 specular = light.specular * spec * m.specular;
+return (ambient + diffuse + specular) * attenuation * intensity;
+}
+)glsl" },
+	{ "src/shaders/include/material.glsl",
+		R"glsl(struct Material {
+sampler2D diffuse;
+#if HAS_SPECULAR_MAP
+sampler2D specular;
+#endif
+float shininess;
+};
+struct MaterialSample {
+vec3 diffuse;
+vec3 specular;
+float shininess;
+};
+MaterialSample SampleMaterial(Material material, vec2 texCoords)
+{
+MaterialSample s;
+s.diffuse = vec3(texture(material.diffuse, texCoords));
+#if HAS_SPECULAR_MAP
+s.specular = vec3(texture(material.specular, texCoords));
+#else
+s.specular = vec3(0.5);
+#endif
+s.shininess = material.shininess;
+return s;
+}
+)glsl" },
+};
+
+// linear search, there are only a handful of files and it runs once per shader build
+inline const File* find(std::string_view path)
+{
+	for (const File& file : files)
+		if (file.path == path)
+			return &file;
+	return nullptr;
+}
+}
+
+#endif
@@ -0,0 +1,129 @@
+// Generated by tools/gen_shader_reflection.py from src/shaders, do not edit.
+#ifndef SHADER_REFLECTION_H
+#define SHADER_REFLECTION_H
+
+#include "../uniform_field.h"
+
+#include <cstddef>
+#include <string>
+
+namespace ShaderReflection
+{
+
+// std140 byte offsets of uniform block Lights (array members : element 0, plus _stride)
+struct LightsBlock
+{
+	static constexpr std::size_t size = 400;
+	static constexpr std::size_t dirLight = 0;
+	static constexpr std::size_t dirLight_direction = 0;
+	static constexpr std::size_t dirLight_ambient = 16;
+	static constexpr std::size_t dirLight_diffuse = 32;
+	static constexpr std::size_t dirLight_specular = 48;
+	static constexpr std::size_t pointLights_stride = 64;
+	static constexpr std::size_t pointLights = 64;
+	static constexpr std::size_t pointLights_position = 64;
+	static constexpr std::size_t pointLights_constant = 76;
+	static constexpr std::size_t pointLights_ambient = 80;
+	static constexpr std::size_t pointLights_linear = 92;
+	static constexpr std::size_t pointLights_diffuse = 96;
+	static constexpr std::size_t pointLights_quadratic = 108;
+	static constexpr std::size_t pointLights_specular = 112;
+	static constexpr std::size_t spotLight = 320;
+	static constexpr std::size_t spotLight_position = 320;
+	static constexpr std::size_t spotLight_cutOff = 332;
+	static constexpr std::size_t spotLight_direction = 336;
+	static constexpr std::size_t spotLight_outerCutOff = 348;
+	static constexpr std::size_t spotLight_ambient = 352;
+	static constexpr std::size_t spotLight_constant = 364;
+	static constexpr std::size_t spotLight_diffuse = 368;
+	static constexpr std::size_t spotLight_linear = 380;
+	static constexpr std::size_t spotLight_specular = 384;
+	static constexpr std::size_t spotLight_quadratic = 396;
+};
+
+// std140 byte offsets of uniform block Object (array members : element 0, plus _stride)
+struct ObjectBlock
+{
+	static constexpr std::size_t size = 128;
+	static constexpr std::size_t model = 0;
+	static constexpr std::size_t normalMatrix = 64;
+};
+
+// basic_lighting.vs + basic_lighting.fs
+struct BasicLighting
+{
+	static constexpr const char* vertexPath = "src/shaders/basic_lighting.vs";
+	static constexpr const char* fragmentPath = "src/shaders/basic_lighting.fs";
+
+	UniformField<int> drawData;
+	UniformField<int> drawIdBase;
+	UniformField<glm::mat4> view;
+	UniformField<glm::mat4> projection;
+	UniformField<glm::vec3> positionOffset;
+	UniformField<glm::vec3> positionScale;
+	UniformField<glm::vec3> viewPos;
+	struct Material_t {
+		UniformField<int> diffuse;
+		UniformField<int> specular;
+		UniformField<float> shininess;
+	} material;
+
+	// resolves every location, only needed again after the program is relinked
+	void resolve(const Shader& shader)
+	{
+		drawData.location = shader.uniformLocation("drawData");
+		drawIdBase.location = shader.uniformLocation("drawIdBase");
+		view.location = shader.uniformLocation("view");
+		projection.location = shader.uniformLocation("projection");
+		positionOffset.location = shader.uniformLocation("positionOffset");
+		positionScale.location = shader.uniformLocation("positionScale");
+		viewPos.location = shader.uniformLocation("viewPos");
+		material.diffuse.location = shader.uniformLocation("material.diffuse");
+		material.specular.location = shader.uniformLocation("material.specular");
+		material.shininess.location = shader.uniformLocation("material.shininess");
+		program = shader.ID;
+	}
+
+	// cheap per-frame check that re-resolves when the shader was rebuilt (hot reload)
+	void bind(const Shader& shader)
+	{
+		if (shader.ID != program)
+			resolve(shader);
+	}
+
+	unsigned int program = 0;
+};
+
+// light_cube.vs + light_cube.fs
+struct LightCube
+{
+	static constexpr const char* vertexPath = "src/shaders/light_cube.vs";
+	static constexpr const char* fragmentPath = "src/shaders/light_cube.fs";
+
+	UniformField<int> drawData;
+	UniformField<int> drawIdBase;
+	UniformField<glm::mat4> view;
+	UniformField<glm::mat4> projection;
+
+	// resolves every location, only needed again after the program is relinked
+	void resolve(const Shader& shader)
+	{
+		drawData.location = shader.uniformLocation("drawData");
+		drawIdBase.location = shader.uniformLocation("drawIdBase");
+		view.location = shader.uniformLocation("view");
+		projection.location = shader.uniformLocation("projection");
+		program = shader.ID;
+	}
+
+	// cheap per-frame check that re-resolves when the shader was rebuilt (hot reload)
+	void bind(const Shader& shader)
+	{
+		if (shader.ID != program)
+			resolve(shader);
+	}
+
+	unsigned int program = 0;
+};
+}
+
+#endif
@@ -0,0 +1,25 @@
+// Per-draw constants of a DrawCommandBuilder command list (draw_commands.h), fetched by draw
+// ID instead of read from the "Object" block. 8 texels per draw : model then normalMatrix,
+// one column per texel.
+
+// instanced attribute, the indirect command's baseInstance selects the element
+layout(location = 3) in uint aDrawID;
+
+uniform samplerBuffer drawData;
+uniform int drawIdBase; // added to aDrawID, set per draw when base instances are not available
+
+struct DrawConstants {
+	mat4 model;
+	mat4 normalMatrix;
+};
+
+DrawConstants FetchDrawConstants()
+{
+	int texel = (int(aDrawID) + drawIdBase) * 8;
+	DrawConstants c;
+	c.model = mat4(texelFetch(drawData, texel), texelFetch(drawData, texel + 1),
+		texelFetch(drawData, texel + 2), texelFetch(drawData, texel + 3));
+	c.normalMatrix = mat4(texelFetch(drawData, texel + 4), texelFetch(drawData, texel + 5),
+		texelFetch(drawData, texel + 6), texelFetch(drawData, texel + 7));
+	return c;
+}
@@ -0,0 +1,103 @@
+// Light rig shared by every program that lights geometry.
+// The light structs live in a std140 uniform block mirrored by LightBlockStd140 in light_rig.h.
+// Each float is placed right after a vec3 so it fills that vec3's 16 byte slot.
+// The block always holds MAX_POINT_LIGHTS lights so its layout does not depend on the permutation,
+// NR_POINT_LIGHTS only decides how many of them are evaluated.
+
+#define MAX_POINT_LIGHTS 4
+
+struct DirLight {
+	vec3 direction;
+
+	vec3 ambient;
+	vec3 diffuse;
+	vec3 specular;
+};
+
+struct PointLight {
+	vec3 position;
+	float constant;
+
+	vec3 ambient;
+	float linear;
+	vec3 diffuse;
+	float quadratic;
+	vec3 specular;
+};
+
+struct SpotLight {
+	vec3 position;
+	float cutOff;
+	vec3 direction;
+	float outerCutOff;
+
+	vec3 ambient;
+	float constant;
+	vec3 diffuse;
+	float linear;
+	vec3 specular;
+	float quadratic;
+};
+
+layout (std140) uniform Lights {
+	DirLight dirLight;
+	PointLight pointLights[MAX_POINT_LIGHTS];
+	SpotLight spotLight;
+};
+
+vec3 CalcDirLight(DirLight light, MaterialSample m, vec3 normal, vec3 viewDir)
+{
+	vec3 lightDir = normalize(-light.direction);
+	// diffuse shading
+	float diff = max(dot(normal, lightDir), 0.0);
+	// specular shading
+	vec3 reflectDir = reflect(-lightDir, normal);
+	float spec = pow(max(dot(viewDir, reflectDir), 0.0), m.shininess);
+	// combine results
+	vec3 ambient = light.ambient * m.diffuse;
+	vec3 diffuse = light.diffuse * diff * m.diffuse;
+	vec3 specular = light.specular * spec * m.specular;
+	return (ambient + diffuse + specular);
+}
+
+vec3 CalcPointLight(PointLight light, MaterialSample m, vec3 normal, vec3 fragPos, vec3 viewDir)
+{
+	vec3 lightDir = normalize(light.position - fragPos);
+	// diffuse shading
+	float diff = max(dot(normal, lightDir), 0.0);
+	// specular shading
+	vec3 reflectDir = reflect(-lightDir, normal);
+	float spec = pow(max(dot(viewDir, reflectDir), 0.0), m.shininess);
+	// attenuation
+	float distance = length(light.position - fragPos);
+	float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+	// combine results
+	vec3 ambient = light.ambient * m.diffuse;
+	vec3 diffuse = light.diffuse * diff * m.diffuse;
+	vec3 specular = light.specular * spec * m.specular;
+	return (ambient + diffuse + specular) * attenuation;
+}
+
+vec3 CalcSpotLight(SpotLight light, MaterialSample m, vec3 normal, vec3 fragPos, vec3 viewDir)
+{
+	vec3 lightDir = normalize(light.position - fragPos);
+	// diffuse shading
+	float diff = max(dot(normal, lightDir), 0.0);
+	// specular shading
+	vec3 reflectDir = reflect(-lightDir, normal);
+	float spec = pow(max(dot(viewDir, reflectDir), 0.0), m.shininess);
+	// attenuation
+	float distance = length(light.position - fragPos);
+	float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+
+	// spotlight (soft edges)
+	float theta = dot(lightDir, normalize(-light.direction));
+	float epsilon = light.cutOff - light.outerCutOff;
+	float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+
+	// combine results
+	vec3 ambient = light.ambient * m.diffuse;
+	vec3 diffuse = light.diffuse * diff * m.diffuse;
+	vec3 specular = light.specular * spec * m.specular;
+	return (ambient + diffuse + specular) * attenuation * intensity;
+}
@@ -0,0 +1,29 @@
+// Material textures, sampled once per fragment and shared by every light.
+// HAS_SPECULAR_MAP (0/1) selects whether a specular texture is bound.
+
+struct Material {
+	sampler2D diffuse;
+#if HAS_SPECULAR_MAP
+	sampler2D specular;
+#endif
+	float shininess;
+};
+
+struct MaterialSample {
+	vec3 diffuse;
+	vec3 specular;
+	float shininess;
+};
+
+MaterialSample SampleMaterial(Material material, vec2 texCoords)
+{
+	MaterialSample s;
+	s.diffuse = vec3(texture(material.diffuse, texCoords));
+#if HAS_SPECULAR_MAP
+	s.specular = vec3(texture(material.specular, texCoords));
+#else
+	s.specular = vec3(0.5);
+#endif
+	s.shininess = material.shininess;
+	return s;
+}
@@ -1,11 +1,36 @@
 #version 330 core
+
+// Permutation switches, injected by the shader loader. These are the defaults when nothing is injected.
+#ifndef MULTI_DRAW
+#define MULTI_DRAW 0
+#endif
+#ifndef INSTANCED
+#define INSTANCED 0
+#endif
+
 layout(location = 0) in vec3 aPos;
 
-uniform mat4 model;
+#if INSTANCED
+// same instance layout as basic_lighting.vs, aNormalMatrix (location 8) is unused here
+layout(location = 4) in mat4 aModel;
+#elif MULTI_DRAW
+#include "include/draw_data.glsl"
+#else
+// same block as basic_lighting.vs, normalMatrix is unused here
+layout (std140) uniform Object {
+	mat4 model;
+	mat4 normalMatrix;
+};
+#endif
 uniform mat4 view;
 uniform mat4 projection;
 
 void main()
 {
+#if INSTANCED
+	mat4 model = aModel;
+#elif MULTI_DRAW
+	mat4 model = FetchDrawConstants().model;
+#endif
 	gl_Position = projection * view * model * vec4(aPos, 1.0);
 }
\ No newline at end of file
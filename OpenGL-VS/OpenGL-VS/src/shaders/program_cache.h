@@ -0,0 +1,165 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h> // include glad to get all the required OpenGL headers
+
+#include "../gl_extensions.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Persistent cache of linked program binaries.
+// A program is keyed by its vertex + fragment source and the driver identity
+// (vendor, renderer, version), so a driver update or an edited shader simply misses.
+class ProgramBinaryCache
+{
+public:
+	// statistics since startup
+	unsigned int hits = 0;
+	unsigned int misses = 0;
+
+	explicit ProgramBinaryCache(std::string directory) : directory(std::move(directory)) {}
+
+	// false when the driver cannot hand out program binaries at all
+	bool enabled() const { return glExt.programBinary; }
+
+	std::uint64_t makeKey(std::string_view vertexCode, std::string_view fragmentCode)
+	{
+		if (driverId.empty())
+		{
+			driverId.append((const char*)glGetString(GL_VENDOR)).push_back('\n');
+			driverId.append((const char*)glGetString(GL_RENDERER)).push_back('\n');
+			driverId.append((const char*)glGetString(GL_VERSION));
+		}
+
+		std::uint64_t hash = 14695981039346656037ull;
+		hash = hashBytes(hash, driverId);
+		hash = hashBytes(hash, std::string_view("\0", 1));
+		hash = hashBytes(hash, vertexCode);
+		hash = hashBytes(hash, std::string_view("\0", 1));
+		hash = hashBytes(hash, fragmentCode);
+		return hash;
+	}
+
+	// loads the binary stored under key into program, true if it linked
+	bool load(std::uint64_t key, unsigned int program)
+	{
+		if (!enabled())
+			return false;
+
+		std::ifstream file(pathFor(key), std::ios::binary | std::ios::ate);
+		if (!file)
+		{
+			misses++;
+			return false;
+		}
+		std::streamoff fileSize = file.tellg();
+		file.seekg(0);
+
+		Header header{};
+		file.read((char*)&header, sizeof(header));
+		std::vector<char> binary;
+		// a truncated or corrupt entry must not size the allocation or reach the driver
+		bool intact = file && header.magic == MAGIC && header.key == key && header.length > 0
+			&& (std::streamoff)header.length == fileSize - (std::streamoff)sizeof(header);
+		if (intact)
+		{
+			binary.resize(header.length);
+			file.read(binary.data(), (std::streamsize)binary.size());
+			intact = file && file.gcount() == (std::streamsize)binary.size();
+		}
+
+		if (!intact)
+		{
+			std::cout << "[LOG] > msg : Program cache entry " << pathFor(key) << " is stale, recompiling" << std::endl;
+			misses++;
+			return false;
+		}
+
+		glExt.ProgramBinary(program, header.format, binary.data(), (GLsizei)binary.size());
+		int success = 0;
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		if (!success)
+		{
+			// the driver rejected the blob (e.g. after an update that kept the version string)
+			std::cout << "[LOG] > msg : Program cache entry " << pathFor(key) << " rejected by driver, recompiling" << std::endl;
+			misses++;
+			return false;
+		}
+
+		hits++;
+		return true;
+	}
+
+	// writes the binary of a successfully linked program under key
+	void store(std::uint64_t key, unsigned int program)
+	{
+		if (!enabled())
+			return;
+
+		GLint length = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0)
+			return;
+
+		Header header{};
+		header.magic = MAGIC;
+		header.key = key;
+		std::vector<char> binary(length);
+		GLsizei written = 0;
+		glExt.GetProgramBinary(program, length, &written, &header.format, binary.data());
+		header.length = (std::uint32_t)written;
+
+		std::error_code error;
+		std::filesystem::create_directories(directory, error);
+		std::ofstream file(pathFor(key), std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			std::cout << "[Err : ProgramCache] > msg : Cannot write " << pathFor(key) << std::endl;
+			return;
+		}
+		file.write((const char*)&header, sizeof(header));
+		file.write(binary.data(), written);
+	}
+
+private:
+	static constexpr std::uint32_t MAGIC = 0x42504C47; // "GLPB"
+
+	struct Header
+	{
+		std::uint32_t magic;
+		std::uint32_t format;
+		std::uint64_t key;
+		std::uint32_t length;
+		std::uint32_t reserved;
+	};
+
+	std::string directory;
+	std::string driverId;
+
+	std::string pathFor(std::uint64_t key) const
+	{
+		char name[32];
+		std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+		return (std::filesystem::path(directory) / name).string();
+	}
+
+	static std::uint64_t hashBytes(std::uint64_t hash, std::string_view bytes)
+	{
+		// FNV-1a 64
+		for (char c : bytes)
+		{
+			hash ^= static_cast<unsigned char>(c);
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+};
+
+#endif
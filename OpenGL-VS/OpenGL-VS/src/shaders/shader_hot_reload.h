@@ -0,0 +1,268 @@
+#ifndef SHADER_HOT_RELOAD_H
+#define SHADER_HOT_RELOAD_H
+
+#include "shader_s.h"
+#include "shader_preprocessor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// Watches every file a set of shaders was built from and rebuilds them when one changes.
+// A worker thread waits for changes (inotify on Linux, timestamp polling elsewhere) and
+// re-reads + preprocesses the sources, the GL thread only submits the compile in update()
+// and keeps drawing with the old program until the new one has linked.
+class ShaderHotReloader
+{
+public:
+	~ShaderHotReloader()
+	{
+		stop();
+	}
+
+	// GL thread, call before start()
+	void watch(Shader* shader)
+	{
+		Entry entry;
+		entry.shader = shader;
+		entry.vertexPath = shader->vertexPath();
+		entry.fragmentPath = shader->fragmentPath();
+		entry.defines = shader->defines();
+		entry.files = shader->sourceFiles();
+		std::lock_guard<std::mutex> lock(mutex);
+		entries.push_back(std::move(entry));
+	}
+
+	void start()
+	{
+		if (running)
+			return;
+		running = true;
+		worker = std::thread(&ShaderHotReloader::run, this);
+	}
+
+	void stop()
+	{
+		if (!running)
+			return;
+		running = false;
+		worker.join();
+	}
+
+	// GL thread, once per frame: submits the sources read by the worker and swaps in
+	// programs that finished linking. Returns how many programs were swapped.
+	unsigned int update()
+	{
+		std::vector<Reloaded> sources;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			sources.swap(reloaded);
+		}
+		for (Reloaded& source : sources)
+		{
+			source.shader->reload(source.vertexCode, source.fragmentCode);
+			if (std::find(rebuilding.begin(), rebuilding.end(), source.shader) == rebuilding.end())
+				rebuilding.push_back(source.shader);
+		}
+
+		unsigned int swapped = 0;
+		for (std::size_t i = 0; i < rebuilding.size();)
+		{
+			Shader* shader = rebuilding[i];
+			if (shader->updateReload())
+				swapped++;
+			// done once the reload either linked or was dropped
+			if (!shader->isReloading())
+			{
+				rebuilding.erase(rebuilding.begin() + i);
+				continue;
+			}
+			i++;
+		}
+		return swapped;
+	}
+
+private:
+	struct Entry
+	{
+		Shader* shader = nullptr;
+		std::string vertexPath;
+		std::string fragmentPath;
+		ShaderDefines defines;
+		std::vector<std::string> files;
+	};
+
+	struct Reloaded
+	{
+		Shader* shader;
+		std::string vertexCode;
+		std::string fragmentCode;
+	};
+
+	std::mutex mutex;
+	std::vector<Entry> entries;          // guarded by mutex
+	std::vector<Reloaded> reloaded;      // guarded by mutex
+	std::vector<Shader*> rebuilding;     // GL thread only
+	std::thread worker;
+	std::atomic<bool> running{ false };
+
+	// time to let an editor finish writing before the file is read
+	static constexpr std::chrono::milliseconds SETTLE_TIME{ 50 };
+
+	// worker thread: re-reads every shader that uses one of the changed files
+	void reloadChanged(const std::vector<std::string>& changed)
+	{
+		// copy the affected entries so the files are read without holding the lock
+		std::vector<Entry> affected;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (const Entry& entry : entries)
+			{
+				bool uses = std::any_of(entry.files.begin(), entry.files.end(), [&](const std::string& file) {
+					return std::find(changed.begin(), changed.end(), file) != changed.end();
+				});
+				if (uses)
+					affected.push_back(entry);
+			}
+		}
+
+		for (Entry& entry : affected)
+		{
+			Reloaded source;
+			source.shader = entry.shader;
+			ShaderPreprocessor preprocessor;
+			if (!preprocessor.process(entry.vertexPath, entry.defines, source.vertexCode))
+				continue;
+			std::vector<std::string> files = preprocessor.files;
+			if (!preprocessor.process(entry.fragmentPath, entry.defines, source.fragmentCode))
+				continue;
+			files.insert(files.end(), preprocessor.files.begin(), preprocessor.files.end());
+
+			std::lock_guard<std::mutex> lock(mutex);
+			// an edit may have added or removed includes
+			for (Entry& watched : entries)
+				if (watched.shader == entry.shader)
+					watched.files = files;
+			reloaded.push_back(std::move(source));
+		}
+	}
+
+	std::vector<std::string> watchedFiles()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		std::vector<std::string> result;
+		for (const Entry& entry : entries)
+			for (const std::string& file : entry.files)
+				if (std::find(result.begin(), result.end(), file) == result.end())
+					result.push_back(file);
+		return result;
+	}
+
+#ifdef __linux__
+	void run()
+	{
+		int fd = inotify_init1(IN_NONBLOCK);
+		if (fd < 0)
+		{
+			std::cout << "[Err : ShaderHotReload] > msg : inotify unavailable, hot reload disabled" << std::endl;
+			return;
+		}
+
+		// watch directories rather than files, editors often save by writing a new file and renaming it
+		std::map<int, std::string> directories;
+		auto watchDirectories = [&]() {
+			for (const std::string& file : watchedFiles())
+			{
+				std::string directory = std::filesystem::path(file).parent_path().generic_string();
+				if (directory.empty())
+					directory = ".";
+				int wd = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+				if (wd >= 0)
+					directories[wd] = directory;
+			}
+		};
+		watchDirectories();
+
+		alignas(inotify_event) char buffer[4096];
+		while (running)
+		{
+			pollfd descriptor{ fd, POLLIN, 0 };
+			if (poll(&descriptor, 1, 100) <= 0)
+				continue;
+
+			std::vector<std::string> changed;
+			auto drain = [&]() {
+				ssize_t length;
+				while ((length = read(fd, buffer, sizeof(buffer))) > 0)
+				{
+					for (char* p = buffer; p < buffer + length;)
+					{
+						const inotify_event* event = (const inotify_event*)p;
+						if (event->len > 0 && directories.count(event->wd))
+						{
+							std::string file = (std::filesystem::path(directories[event->wd]) / event->name).lexically_normal().generic_string();
+							if (std::find(changed.begin(), changed.end(), file) == changed.end())
+								changed.push_back(file);
+						}
+						p += sizeof(inotify_event) + event->len;
+					}
+				}
+			};
+			drain();
+			// one save usually produces several events, coalesce them
+			std::this_thread::sleep_for(SETTLE_TIME);
+			drain();
+
+			reloadChanged(changed);
+			watchDirectories(); // pick up directories of newly included files
+		}
+		close(fd);
+	}
+#else
+	void run()
+	{
+		// no native watcher wired up on this platform, poll the timestamps instead
+		std::map<std::string, std::filesystem::file_time_type> stamps;
+		auto snapshot = [&](std::vector<std::string>* changed) {
+			for (const std::string& file : watchedFiles())
+			{
+				std::error_code error;
+				auto stamp = std::filesystem::last_write_time(file, error);
+				if (error)
+					continue;
+				auto it = stamps.find(file);
+				if (it != stamps.end() && it->second != stamp && changed)
+					changed->push_back(file);
+				stamps[file] = stamp;
+			}
+		};
+		snapshot(nullptr);
+
+		while (running)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(250));
+			std::vector<std::string> changed;
+			snapshot(&changed);
+			if (changed.empty())
+				continue;
+			std::this_thread::sleep_for(SETTLE_TIME);
+			reloadChanged(changed);
+		}
+	}
+#endif
+};
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef SHADER_LIBRARY_H
+#define SHADER_LIBRARY_H
+
+#include "shader_s.h"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+// Memoizes compiled shader permutations.
+// A permutation is the vertex/fragment path pair plus its define list, asking for the
+// same one twice returns the program built the first time instead of recompiling.
+class ShaderLibrary
+{
+public:
+	// statistics since startup
+	unsigned int builds = 0;
+	unsigned int reuses = 0;
+
+	// cache / async settings used for every program built by the library
+	ShaderOptions baseOptions;
+
+	Shader* get(const char* vertexPath, const char* fragmentPath, const ShaderDefines& defines = ShaderDefines())
+	{
+		std::string key = std::string(vertexPath) + "|" + fragmentPath + "|" + defines.key();
+		auto it = programs.find(key);
+		if (it != programs.end()) {
+			reuses++;
+			return it->second.get();
+		}
+
+		ShaderOptions options = baseOptions;
+		options.defines = defines;
+		Shader* shader = new Shader(vertexPath, fragmentPath, options);
+		programs.emplace(std::move(key), std::unique_ptr<Shader>(shader));
+		builds++;
+		return shader;
+	}
+
+	std::size_t size() const
+	{
+		return programs.size();
+	}
+
+	// deletes every program, pointers returned by get() become invalid
+	void clear()
+	{
+		programs.clear();
+	}
+
+private:
+	std::unordered_map<std::string, std::unique_ptr<Shader>> programs;
+};
+
+#endif
@@ -0,0 +1,222 @@
+#ifndef SHADER_PREPROCESSOR_H
+#define SHADER_PREPROCESSOR_H
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#ifdef EMBED_SHADERS
+// every file under src/shaders baked in at build time (tools/embed_shaders.py)
+#include "generated/embedded_shaders.h"
+#endif
+
+// #define list injected into a shader right after its #version line.
+// Together with the source paths it forms the permutation key of a program.
+class ShaderDefines
+{
+public:
+	ShaderDefines& set(const std::string& name, const std::string& value = "1")
+	{
+		auto it = std::lower_bound(values.begin(), values.end(), name,
+			[](const std::pair<std::string, std::string>& entry, const std::string& key) { return entry.first < key; });
+		if (it != values.end() && it->first == name)
+			it->second = value;
+		else
+			values.insert(it, { name, value });
+		return *this;
+	}
+
+	ShaderDefines& set(const std::string& name, int value)
+	{
+		return set(name, std::to_string(value));
+	}
+
+	// canonical "NAME=VALUE;" list, identical for identical permutations whatever the set() order
+	std::string key() const
+	{
+		std::string result;
+		for (const auto& entry : values)
+			result.append(entry.first).append("=").append(entry.second).append(";");
+		return result;
+	}
+
+	// "#define NAME VALUE" lines
+	std::string source() const
+	{
+		std::string result;
+		for (const auto& entry : values)
+			result.append("#define ").append(entry.first).append(" ").append(entry.second).append("\n");
+		return result;
+	}
+
+private:
+	// kept sorted by name
+	std::vector<std::pair<std::string, std::string>> values;
+};
+
+// Loads a shader file, expands #include "file" (relative to the including file, each file
+// at most once) and injects the defines. #line directives keep compiler errors pointing at
+// the right line, the source string number is the file's index in files.
+// With EMBED_SHADERS defined files come from the table baked into the binary instead of
+// the disk (stripped of comments, so error line numbers refer to the stripped text).
+class ShaderPreprocessor
+{
+public:
+	// every file read while processing, the entry file first
+	std::vector<std::string> files;
+
+	bool process(const std::string& path, const ShaderDefines& defines, std::string& output)
+	{
+		files.clear();
+		output.clear();
+		std::string expanded;
+		if (!expand(path, expanded))
+			return false;
+		return inject(expanded, defines, output);
+	}
+
+	// same for a source already in memory, name stands in for its path (includes are relative to it)
+	bool processSource(const std::string& name, std::string_view source, const ShaderDefines& defines, std::string& output)
+	{
+		files.clear();
+		output.clear();
+		std::string expanded;
+		std::string normalized = std::filesystem::path(name).lexically_normal().generic_string();
+		files.push_back(normalized);
+		if (!expandSource(normalized, source, 0, expanded))
+			return false;
+		return inject(expanded, defines, output);
+	}
+
+	// reads a whole shader file, from the embedded table when shaders are baked in
+	static bool readFile(const std::string& path, std::string& source)
+	{
+#ifdef EMBED_SHADERS
+		const EmbeddedShaders::File* file = EmbeddedShaders::find(path);
+		if (!file) {
+			std::cout << "ERROR::SHADER::FILE_NOT_EMBEDDED : " << path << std::endl;
+			return false;
+		}
+		source.assign(file->source.data(), file->source.size());
+		return true;
+#else
+		std::ifstream file(path);
+		if (!file) {
+			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ : " << path << std::endl;
+			return false;
+		}
+		std::stringstream stream;
+		stream << file.rdbuf();
+		source = stream.str();
+		return true;
+#endif
+	}
+
+private:
+	bool inject(const std::string& expanded, const ShaderDefines& defines, std::string& output)
+	{
+		// the defines must come after #version, which has to stay the first directive
+		std::size_t versionLine = findDirective(expanded, "#version");
+		if (versionLine == std::string::npos) {
+			output = defines.source() + "#line 1 0\n" + expanded;
+			return true;
+		}
+		std::size_t lineEnd = expanded.find('\n', versionLine);
+		lineEnd = (lineEnd == std::string::npos) ? expanded.size() : lineEnd + 1;
+		output = expanded.substr(0, lineEnd);
+		if (!output.empty() && output.back() != '\n')
+			output.push_back('\n');
+		output += defines.source();
+		output += "#line " + std::to_string(countLines(expanded, lineEnd) + 1) + " 0\n";
+		output += expanded.substr(lineEnd);
+		return true;
+	}
+
+	bool expand(const std::string& path, std::string& output)
+	{
+		std::string normalized = std::filesystem::path(path).lexically_normal().generic_string();
+		if (std::find(files.begin(), files.end(), normalized) != files.end())
+			return true; // already included once
+		const std::size_t fileIndex = files.size();
+		files.push_back(normalized);
+
+		std::string source;
+		if (!readFile(normalized, source))
+			return false;
+		return expandSource(normalized, source, fileIndex, output);
+	}
+
+	bool expandSource(const std::string& normalized, std::string_view source, std::size_t fileIndex, std::string& output)
+	{
+		const std::filesystem::path directory = std::filesystem::path(normalized).parent_path();
+		if (fileIndex > 0)
+			output += "#line 1 " + std::to_string(fileIndex) + "\n";
+
+		std::size_t lineNumber = 0;
+		std::size_t position = 0;
+		while (position < source.size()) {
+			std::size_t end = source.find('\n', position);
+			if (end == std::string::npos)
+				end = source.size();
+			std::string_view line = source.substr(position, end - position);
+			lineNumber++;
+			position = end + 1;
+
+			std::string includePath;
+			if (!parseInclude(line, includePath)) {
+				output.append(line.data(), line.size()).push_back('\n');
+				continue;
+			}
+
+			if (!expand((directory / includePath).string(), output))
+				return false;
+			output += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+		}
+		return true;
+	}
+
+	// recognizes   #include "file"   and   #include <file>
+	static bool parseInclude(std::string_view line, std::string& includePath)
+	{
+		std::size_t start = line.find_first_not_of(" \t");
+		if (start == std::string_view::npos || line.compare(start, 8, "#include") != 0)
+			return false;
+		std::size_t open = line.find_first_of("\"<", start + 8);
+		if (open == std::string_view::npos)
+			return false;
+		std::size_t close = line.find(line[open] == '<' ? '>' : '"', open + 1);
+		if (close == std::string_view::npos)
+			return false;
+		includePath = std::string(line.substr(open + 1, close - open - 1));
+		return true;
+	}
+
+	// offset of the first line that starts with the directive, npos if there is none
+	static std::size_t findDirective(const std::string& source, std::string_view directive)
+	{
+		std::size_t position = 0;
+		while (position < source.size()) {
+			std::size_t start = source.find_first_not_of(" \t", position);
+			if (start != std::string::npos && source.compare(start, directive.size(), directive) == 0)
+				return position;
+			position = source.find('\n', position);
+			if (position == std::string::npos)
+				break;
+			position++;
+		}
+		return std::string::npos;
+	}
+
+	static std::size_t countLines(const std::string& source, std::size_t end)
+	{
+		return (std::size_t)std::count(source.begin(), source.begin() + end, '\n');
+	}
+};
+
+#endif
@@ -3,11 +3,45 @@
 
 #include <glad/glad.h> // include glad to get all the required OpenGL headers
 
+#include "../gl_state_cache.h"
+#include "program_cache.h"
+#include "shader_preprocessor.h"
+
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 
+// Resolved uniform location. Look it up once with Shader::uniform() and reuse it,
+// it stays valid for as long as the program is not relinked.
+struct UniformHandle
+{
+	int location = -1;
+};
+
+// optional build settings for a Shader
+struct ShaderOptions
+{
+	// when set, linked programs are stored in / loaded from this cache
+	ProgramBinaryCache* cache = nullptr;
+	// submit compile + link and return right away, status is only queried on first use
+	bool async = false;
+	// injected into both stages after #version
+	ShaderDefines defines;
+};
+
+// a shader stage already in memory (embedded data, generated code), name stands in for its
+// path: includes are resolved relative to it and errors / the hot reloader refer to it
+struct ShaderSource
+{
+	const char* name;
+	std::string_view code;
+};
+
 class Shader
 {
 public:
@@ -16,162 +50,635 @@ public:
 
 
 	// constructor raeds and builds the shader
-	Shader(const char* vertexPath, const char* fragmentPath);
-	// use/activate the shader
+	Shader(const char* vertexPath, const char* fragmentPath, const ShaderOptions& options = ShaderOptions());
+	// builds from in-memory sources, opens no file unless they #include one that is not embedded
+	Shader(const ShaderSource& vertex, const ShaderSource& fragment, const ShaderOptions& options = ShaderOptions());
+	~Shader();
+	Shader(const Shader&) = delete;
+	Shader& operator=(const Shader&) = delete;
+	// use/activate the shader (waits for an async build that is still running)
 	void use();
+	// true once an async build has finished, never blocks when the driver supports
+	// GL_COMPLETION_STATUS_KHR (without it, this finishes the build synchronously)
+	bool isReady();
+	// uniform lookup against the table built after linking (no driver call, no allocation)
+	int uniformLocation(std::string_view name) const;
+	UniformHandle uniform(std::string_view name) const;
+	// connects a uniform block to a binding point, kept across rebuilds of the program
+	void bindUniformBlock(std::string_view blockName, unsigned int binding);
+	// points a sampler uniform at a texture unit, kept across rebuilds of the program
+	void bindSampler(std::string_view samplerName, int unit);
+
+	// hot reload: builds the new sources in the background while ID keeps the old program
+	void reload(const std::string& vertexCode, const std::string& fragmentCode);
+	// call on the GL thread, true when a finished reload was swapped in (a failed one is dropped)
+	bool updateReload();
+	bool isReloading() const { return pendingReload.program != 0; }
+	// what the program was built from, used to re-read it
+	const std::string& vertexPath() const { return vertexSourcePath; }
+	const std::string& fragmentPath() const { return fragmentSourcePath; }
+	const ShaderDefines& defines() const { return sourceDefines; }
+	// every file read for both stages, includes too
+	const std::vector<std::string>& sourceFiles() const { return files; }
 	// utility uniform functions
-	void setBool(const std::string& name, bool value) const;
-	void setInt(const std::string& name, int value) const;
-	void setFloat(const std::string& name, float value) const;
-	void setVec2(const std::string& name, const glm::vec2& value) const;
-	void setVec2(const std::string& name, float x, float y) const;
-	void setVec3(const std::string& name, const glm::vec3& value) const;
-	void setVec3(const std::string& name, float x, float y, float z) const;
-	void setVec4(const std::string& name, const glm::vec4& value) const;
-	void setVec4(const std::string& name, float x, float y, float z, float w) const;
-	void setMat2(const std::string& name, const glm::mat2& mat) const;
-	void setMat3(const std::string& name, const glm::mat3& mat) const;
-	void setMat4(const std::string& name, const glm::mat4& mat) const;
+	void setBool(std::string_view name, bool value) const;
+	void setInt(std::string_view name, int value) const;
+	void setFloat(std::string_view name, float value) const;
+	void setVec2(std::string_view name, const glm::vec2& value) const;
+	void setVec2(std::string_view name, float x, float y) const;
+	void setVec3(std::string_view name, const glm::vec3& value) const;
+	void setVec3(std::string_view name, float x, float y, float z) const;
+	void setVec4(std::string_view name, const glm::vec4& value) const;
+	void setVec4(std::string_view name, float x, float y, float z, float w) const;
+	void setMat2(std::string_view name, const glm::mat2& mat) const;
+	void setMat3(std::string_view name, const glm::mat3& mat) const;
+	void setMat4(std::string_view name, const glm::mat4& mat) const;
+	// same setters taking a precomputed handle
+	void setBool(UniformHandle handle, bool value) const;
+	void setInt(UniformHandle handle, int value) const;
+	void setFloat(UniformHandle handle, float value) const;
+	void setVec2(UniformHandle handle, const glm::vec2& value) const;
+	void setVec2(UniformHandle handle, float x, float y) const;
+	void setVec3(UniformHandle handle, const glm::vec3& value) const;
+	void setVec3(UniformHandle handle, float x, float y, float z) const;
+	void setVec4(UniformHandle handle, const glm::vec4& value) const;
+	void setVec4(UniformHandle handle, float x, float y, float z, float w) const;
+	void setMat2(UniformHandle handle, const glm::mat2& mat) const;
+	void setMat3(UniformHandle handle, const glm::mat3& mat) const;
+	void setMat4(UniformHandle handle, const glm::mat4& mat) const;
 
 private:
+	// one slot of the open addressing uniform table, empty slots have location -1
+	struct UniformSlot
+	{
+		std::uint32_t hash = 0;
+		int location = -1;
+		std::uint32_t nameOffset = 0;
+		std::uint32_t nameLength = 0;
+	};
+
+	// power of two sized, at most half full so probing always hits an empty slot
+	std::vector<UniformSlot> uniformSlots;
+	// all uniform names back to back, slots point into it
+	std::string uniformNames;
+
+	// uniform block name -> binding point, applied whenever the program (re)links
+	std::vector<std::pair<std::string, unsigned int>> blockBindings;
+	// sampler name -> texture unit, applied whenever the program (re)links
+	std::vector<std::pair<std::string, int>> samplerBindings;
+
+	// a compile + link that was submitted but not checked yet
+	struct PendingBuild
+	{
+		unsigned int program = 0;
+		unsigned int vertex = 0;
+		unsigned int fragment = 0;
+		ProgramBinaryCache* cache = nullptr;
+		std::uint64_t cacheKey = 0;
+	};
+
+	// the first build (its program is ID)
+	bool ready = false;
+	PendingBuild pending;
+	// a hot reload in flight, ID keeps the old program until this one links
+	PendingBuild pendingReload;
+
+	std::string vertexSourcePath;
+	std::string fragmentSourcePath;
+	ShaderDefines sourceDefines;
+	std::vector<std::string> files;
+	ProgramBinaryCache* cache = nullptr;
+
+	// creates the program from preprocessed sources: cache lookup, then compile + link
+	void build(const std::string& vertexCode, const std::string& fragmentCode, bool async);
 	// utility function for checking shader compilation/linking errors.
 	// ------------------------------------------------------------------------
-	void checkCompileErrors(unsigned int shader, std::string type);
+	bool checkCompileErrors(unsigned int shader, std::string type);
+	// compiles both stages and links them into build.program without querying any status
+	void submitBuild(PendingBuild& build, const std::string& vertexCode, const std::string& fragmentCode);
+	// GL_COMPLETION_STATUS_KHR of the link, always true without the extension
+	bool isComplete(const PendingBuild& build) const;
+	// reports errors, stores a linked program in the cache and releases the shader objects
+	bool checkBuild(PendingBuild& build);
+	// checks the first build and builds the uniform table
+	void finishBuild();
+	// enumerates the active uniforms of the linked program into uniformSlots
+	void buildUniformTable();
+	// applies the recorded uniform block and sampler bindings to the linked program
+	void applyBindings() const;
+	void insertUniform(std::string_view name, int location);
+
+	static constexpr std::uint32_t hashUniformName(std::string_view name)
+	{
+		// FNV-1a
+		std::uint32_t hash = 2166136261u;
+		for (char c : name)
+		{
+			hash ^= static_cast<unsigned char>(c);
+			hash *= 16777619u;
+		}
+		return hash;
+	}
 };
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath)
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const ShaderOptions& options)
+	: vertexSourcePath(vertexPath), fragmentSourcePath(fragmentPath), sourceDefines(options.defines), cache(options.cache)
 {
-	// 1. retrieve the vertex/fragment source code from filePath
+	// 1. retrieve the vertex/fragment source code from filePath, with includes expanded and defines injected
 	std::string vertexCode;
 	std::string fragmentCode;
-	std::ifstream vShaderFile;
-	std::ifstream fShaderFile;
-	// ensure ifstream objects can throw exceptions:
-	vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	try
-	{
-		// open files
-		vShaderFile.open(vertexPath);
-		fShaderFile.open(fragmentPath);
-		std::stringstream vShaderStream, fShaderStream;
-		// read file's buffer contents into streams
-		vShaderStream << vShaderFile.rdbuf();
-		fShaderStream << fShaderFile.rdbuf();
-		// close file handlers
-		vShaderFile.close();
-		fShaderFile.close();
-		// convert stream into string
-		vertexCode = vShaderStream.str();
-		fragmentCode = fShaderStream.str();
+	ShaderPreprocessor preprocessor;
+	preprocessor.process(vertexPath, options.defines, vertexCode);
+	files = preprocessor.files;
+	preprocessor.process(fragmentPath, options.defines, fragmentCode);
+	files.insert(files.end(), preprocessor.files.begin(), preprocessor.files.end());
+
+	build(vertexCode, fragmentCode, options.async);
+}
+
+Shader::Shader(const ShaderSource& vertex, const ShaderSource& fragment, const ShaderOptions& options)
+	: vertexSourcePath(vertex.name), fragmentSourcePath(fragment.name), sourceDefines(options.defines), cache(options.cache)
+{
+	// 1. the sources are already here, only includes and defines are resolved
+	std::string vertexCode;
+	std::string fragmentCode;
+	ShaderPreprocessor preprocessor;
+	preprocessor.processSource(vertex.name, vertex.code, options.defines, vertexCode);
+	files = preprocessor.files;
+	preprocessor.processSource(fragment.name, fragment.code, options.defines, fragmentCode);
+	files.insert(files.end(), preprocessor.files.begin(), preprocessor.files.end());
+
+	build(vertexCode, fragmentCode, options.async);
+}
+
+void Shader::build(const std::string& vertexCode, const std::string& fragmentCode, bool async)
+{
+	// 2. reuse the linked binary from the last run if the sources and driver are unchanged
+	ID = glCreateProgram();
+	pending.program = ID;
+	if (cache && cache->enabled())
+	{
+		pending.cache = cache;
+		pending.cacheKey = cache->makeKey(vertexCode, fragmentCode);
+		if (cache->load(pending.cacheKey, ID))
+		{
+			buildUniformTable();
+			applyBindings();
+			pending = PendingBuild();
+			ready = true;
+			return;
+		}
+		// a failed glProgramBinary leaves the object unlinked, start from a clean one
+		glDeleteProgram(ID);
+		ID = glCreateProgram();
+		pending.program = ID;
 	}
-	catch (std::ifstream::failure e)
+
+	// 3. compile and link, checked later
+	submitBuild(pending, vertexCode, fragmentCode);
+
+	// 4. a synchronous build checks the results right here
+	if (!async)
+		finishBuild();
+}
+
+Shader::~Shader()
+{
+	for (PendingBuild* build : { &pending, &pendingReload })
 	{
-		std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+		if (build->vertex)
+			glDeleteShader(build->vertex);
+		if (build->fragment)
+			glDeleteShader(build->fragment);
 	}
+	if (pendingReload.program)
+		glDeleteProgram(pendingReload.program);
+	glState.forgetProgram(ID);
+	glDeleteProgram(ID);
+}
+
+void Shader::use()
+{
+	if (!ready)
+		finishBuild();
+	glState.useProgram(ID);
+}
+
+bool Shader::isReady()
+{
+	if (ready)
+		return true;
+
+	if (!isComplete(pending))
+		return false;
+
+	finishBuild();
+	return true;
+}
+
+void Shader::reload(const std::string& vertexCode, const std::string& fragmentCode)
+{
+	// a newer edit replaces a reload that is still compiling
+	if (pendingReload.program)
+	{
+		glDeleteShader(pendingReload.vertex);
+		glDeleteShader(pendingReload.fragment);
+		glDeleteProgram(pendingReload.program);
+	}
+
+	pendingReload = PendingBuild();
+	pendingReload.program = glCreateProgram();
+	if (cache && cache->enabled())
+	{
+		pendingReload.cache = cache;
+		pendingReload.cacheKey = cache->makeKey(vertexCode, fragmentCode);
+	}
+	submitBuild(pendingReload, vertexCode, fragmentCode);
+}
+
+bool Shader::updateReload()
+{
+	if (!pendingReload.program || !isComplete(pendingReload))
+		return false;
+
+	unsigned int program = pendingReload.program;
+	bool linked = checkBuild(pendingReload);
+	pendingReload = PendingBuild();
+	if (!linked)
+	{
+		std::cout << "[LOG] > msg : Reload of " << vertexSourcePath << " / " << fragmentSourcePath << " failed, keeping the previous program" << std::endl;
+		glDeleteProgram(program);
+		return false;
+	}
+
+	// the first build may still be running, the reload supersedes it
+	if (!ready)
+	{
+		checkBuild(pending);
+		pending = PendingBuild();
+		ready = true;
+	}
+
+	// glDeleteProgram only flags a current program, and applyBindings() would restore it as the
+	// previous one: move the binding over to the replacement before the old one goes
+	unsigned int old = ID;
+	ID = program;
+	if (glState.program() == old)
+		glState.useProgram(ID);
+	glState.forgetProgram(old);
+	glDeleteProgram(old);
+	buildUniformTable();
+	applyBindings();
+	std::cout << "[LOG] > msg : Reloaded " << vertexSourcePath << " / " << fragmentSourcePath << std::endl;
+	return true;
+}
+
+void Shader::submitBuild(PendingBuild& build, const std::string& vertexCode, const std::string& fragmentCode)
+{
 	const char* vShaderCode = vertexCode.c_str();
 	const char* fShaderCode = fragmentCode.c_str();
 
-	// 2. compile shaders
-	unsigned int vertex, fragment;
-	int success;
-	char infoLog[512];
+	if (build.cache)
+		glExt.ProgramParameteri(build.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 
+	// no status is queried in between, so the driver is free to compile
+	// both stages and link in the background
 	// vertex shader
-	vertex = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertex, 1, &vShaderCode, NULL);
-	glCompileShader(vertex);
-	checkCompileErrors(vertex, "VERTEX");
+	build.vertex = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(build.vertex, 1, &vShaderCode, NULL);
+	glCompileShader(build.vertex);
 
 	// similiar for fragment shader
-	fragment = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragment, 1, &fShaderCode, NULL);
-	glCompileShader(fragment);
-	checkCompileErrors(fragment, "FRAGMENT");
+	build.fragment = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(build.fragment, 1, &fShaderCode, NULL);
+	glCompileShader(build.fragment);
 
 	// shader Program
-	ID = glCreateProgram();
-	glAttachShader(ID, vertex);
-	glAttachShader(ID, fragment);
-	glLinkProgram(ID);
-	checkCompileErrors(ID, "PROGRAM");
+	glAttachShader(build.program, build.vertex);
+	glAttachShader(build.program, build.fragment);
+	glLinkProgram(build.program);
+}
+
+bool Shader::isComplete(const PendingBuild& build) const
+{
+	if (!glExt.parallelShaderCompile)
+		return true;
+
+	int completed = GL_FALSE;
+	glGetProgramiv(build.program, GL_COMPLETION_STATUS_KHR, &completed);
+	return completed != GL_FALSE;
+}
+
+bool Shader::checkBuild(PendingBuild& build)
+{
+	checkCompileErrors(build.vertex, "VERTEX");
+	checkCompileErrors(build.fragment, "FRAGMENT");
+	bool linked = checkCompileErrors(build.program, "PROGRAM");
+	if (linked && build.cache)
+		build.cache->store(build.cacheKey, build.program);
 
 	// delete the shaders as they're linked into our program now and no longer necessary
-	glDeleteShader(vertex);
-	glDeleteShader(fragment);
+	glDeleteShader(build.vertex);
+	glDeleteShader(build.fragment);
+	build.vertex = 0;
+	build.fragment = 0;
+	return linked;
 }
 
-void Shader::use()
+void Shader::finishBuild()
 {
-	glUseProgram(ID);
+	checkBuild(pending);
+	pending = PendingBuild();
+	buildUniformTable();
+	applyBindings();
+	ready = true;
 }
 
-void Shader::setBool(const std::string& name, bool value) const
+int Shader::uniformLocation(std::string_view name) const
 {
-	glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+	if (uniformSlots.empty())
+		return -1;
+
+	const std::uint32_t hash = hashUniformName(name);
+	const std::size_t mask = uniformSlots.size() - 1;
+	for (std::size_t i = hash & mask;; i = (i + 1) & mask)
+	{
+		const UniformSlot& slot = uniformSlots[i];
+		if (slot.location < 0)
+			return -1;
+		if (slot.hash == hash && std::string_view(uniformNames).substr(slot.nameOffset, slot.nameLength) == name)
+			return slot.location;
+	}
 }
 
-void Shader::setInt(const std::string& name, int value) const
+UniformHandle Shader::uniform(std::string_view name) const
 {
-	glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+	return UniformHandle{ uniformLocation(name) };
 }
+// ------------------------------------------------------------------------
 
-void Shader::setFloat(const std::string& name, float value) const
+void Shader::setBool(std::string_view name, bool value) const
 {
-	glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+	setBool(uniform(name), value);
 }
 
-void Shader::setVec2(const std::string& name, const glm::vec2& value) const
+void Shader::setInt(std::string_view name, int value) const
 {
-	glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+	setInt(uniform(name), value);
 }
 
-void Shader::setVec2(const std::string& name, float x, float y) const
+void Shader::setFloat(std::string_view name, float value) const
 {
-	glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+	setFloat(uniform(name), value);
+}
+
+void Shader::setVec2(std::string_view name, const glm::vec2& value) const
+{
+	setVec2(uniform(name), value);
+}
+
+void Shader::setVec2(std::string_view name, float x, float y) const
+{
+	setVec2(uniform(name), x, y);
+}
+
+void Shader::setVec3(std::string_view name, const glm::vec3& value) const
+{
+	setVec3(uniform(name), value);
+}
+
+void Shader::setVec3(std::string_view name, float x, float y, float z) const
+{
+	setVec3(uniform(name), x, y, z);
+}
+
+void Shader::setVec4(std::string_view name, const glm::vec4& value) const
+{
+	setVec4(uniform(name), value);
+}
+
+void Shader::setVec4(std::string_view name, float x, float y, float z, float w) const
+{
+	setVec4(uniform(name), x, y, z, w);
+}
+
+void Shader::setMat2(std::string_view name, const glm::mat2& mat) const
+{
+	setMat2(uniform(name), mat);
+}
+
+void Shader::setMat3(std::string_view name, const glm::mat3& mat) const
+{
+	setMat3(uniform(name), mat);
+}
+
+void Shader::setMat4(std::string_view name, const glm::mat4& mat) const
+{
+	setMat4(uniform(name), mat);
+}
+// ------------------------------------------------------------------------
+
+void Shader::setBool(UniformHandle handle, bool value) const
+{
+	glState.uniform1i(handle.location, (int)value);
+}
+
+void Shader::setInt(UniformHandle handle, int value) const
+{
+	glState.uniform1i(handle.location, value);
+}
+
+void Shader::setFloat(UniformHandle handle, float value) const
+{
+	glState.uniform1f(handle.location, value);
+}
+
+void Shader::setVec2(UniformHandle handle, const glm::vec2& value) const
+{
+	glState.uniform2fv(handle.location, &value[0]);
+}
+
+void Shader::setVec2(UniformHandle handle, float x, float y) const
+{
+	setVec2(handle, glm::vec2(x, y));
 }
 // ------------------------------------------------------------------------
 
-void Shader::setVec3(const std::string& name, const glm::vec3& value) const
+void Shader::setVec3(UniformHandle handle, const glm::vec3& value) const
 {
-	glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+	glState.uniform3fv(handle.location, &value[0]);
 }
 
-void Shader::setVec3(const std::string& name, float x, float y, float z) const
+void Shader::setVec3(UniformHandle handle, float x, float y, float z) const
 {
-	glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+	setVec3(handle, glm::vec3(x, y, z));
 }
 // ------------------------------------------------------------------------
 
-void Shader::setVec4(const std::string& name, const glm::vec4& value) const
+void Shader::setVec4(UniformHandle handle, const glm::vec4& value) const
 {
-	glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+	glState.uniform4fv(handle.location, &value[0]);
 }
 
-void Shader::setVec4(const std::string& name, float x, float y, float z, float w) const
+void Shader::setVec4(UniformHandle handle, float x, float y, float z, float w) const
 {
-	glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+	setVec4(handle, glm::vec4(x, y, z, w));
 }
 // ------------------------------------------------------------------------
 
-void Shader::setMat2(const std::string& name, const glm::mat2& mat) const
+void Shader::setMat2(UniformHandle handle, const glm::mat2& mat) const
 {
-	glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+	glState.uniformMatrix2fv(handle.location, &mat[0][0]);
 }
 // ------------------------------------------------------------------------
 
-void Shader::setMat3(const std::string& name, const glm::mat3& mat) const
+void Shader::setMat3(UniformHandle handle, const glm::mat3& mat) const
 {
-	glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+	glState.uniformMatrix3fv(handle.location, &mat[0][0]);
 }
 // ------------------------------------------------------------------------
 
-void Shader::setMat4(const std::string& name, const glm::mat4& mat) const
+void Shader::setMat4(UniformHandle handle, const glm::mat4& mat) const
 {
-	glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+	glState.uniformMatrix4fv(handle.location, &mat[0][0]);
+}
+
+void Shader::buildUniformTable()
+{
+	uniformSlots.clear();
+	uniformNames.clear();
+
+	int linked = 0;
+	glGetProgramiv(ID, GL_LINK_STATUS, &linked);
+	if (!linked)
+		return;
+
+	int count = 0;
+	int maxLength = 0;
+	glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+	// 1. collect every location-backed name (arrays contribute one name per element)
+	struct Found { std::string name; int location; };
+	std::vector<Found> found;
+	std::vector<char> nameBuffer(maxLength > 0 ? maxLength : 1);
+	for (int i = 0; i < count; i++)
+	{
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(ID, (GLuint)i, (GLsizei)nameBuffer.size(), &length, &size, &type, nameBuffer.data());
+		std::string name(nameBuffer.data(), length);
+
+		int location = glGetUniformLocation(ID, name.c_str());
+		if (location < 0)
+			continue; // uniform block members have no location
+
+		found.push_back({ name, location });
+
+		// arrays of basic types are reported once as "name[0]"
+		if (size > 1 && name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+		{
+			std::string base = name.substr(0, name.size() - 3);
+			found.push_back({ base, location });
+			for (int element = 1; element < size; element++)
+			{
+				std::string elementName = base + "[" + std::to_string(element) + "]";
+				int elementLocation = glGetUniformLocation(ID, elementName.c_str());
+				if (elementLocation >= 0)
+					found.push_back({ elementName, elementLocation });
+			}
+		}
+	}
+
+	// 2. size the table for a load factor of at most 0.5 and insert
+	std::size_t capacity = 16;
+	while (capacity < found.size() * 2)
+		capacity *= 2;
+	uniformSlots.resize(capacity);
+	for (const Found& uniform : found)
+		insertUniform(uniform.name, uniform.location);
+}
+
+void Shader::bindUniformBlock(std::string_view blockName, unsigned int binding)
+{
+	bool found = false;
+	for (auto& block : blockBindings)
+	{
+		if (block.first == blockName)
+		{
+			block.second = binding;
+			found = true;
+		}
+	}
+	if (!found)
+		blockBindings.emplace_back(std::string(blockName), binding);
+
+	// a pending build picks the binding up when it finishes
+	if (ready)
+		applyBindings();
+}
+
+void Shader::bindSampler(std::string_view samplerName, int unit)
+{
+	bool found = false;
+	for (auto& sampler : samplerBindings)
+	{
+		if (sampler.first == samplerName)
+		{
+			sampler.second = unit;
+			found = true;
+		}
+	}
+	if (!found)
+		samplerBindings.emplace_back(std::string(samplerName), unit);
+
+	if (ready)
+		applyBindings();
+}
+
+void Shader::applyBindings() const
+{
+	for (const auto& block : blockBindings)
+	{
+		GLuint index = glGetUniformBlockIndex(ID, block.first.c_str());
+		if (index != GL_INVALID_INDEX)
+			glUniformBlockBinding(ID, index, block.second);
+	}
+
+	if (samplerBindings.empty())
+		return;
+
+	// sampler values are program state, set them with the program bound and restore the previous one
+	// (through glState, so its shadow of the current program and the sampler values stays right)
+	GLuint previous = glState.program();
+	glState.useProgram(ID);
+	for (const auto& sampler : samplerBindings)
+		glState.uniform1i(uniformLocation(sampler.first), sampler.second);
+	glState.useProgram(previous);
+}
+
+void Shader::insertUniform(std::string_view name, int location)
+{
+	const std::uint32_t hash = hashUniformName(name);
+	const std::size_t mask = uniformSlots.size() - 1;
+	std::size_t i = hash & mask;
+	while (uniformSlots[i].location >= 0)
+	{
+		if (uniformSlots[i].hash == hash && std::string_view(uniformNames).substr(uniformSlots[i].nameOffset, uniformSlots[i].nameLength) == name)
+			return; // already present
+		i = (i + 1) & mask;
+	}
+
+	UniformSlot& slot = uniformSlots[i];
+	slot.hash = hash;
+	slot.location = location;
+	slot.nameOffset = (std::uint32_t)uniformNames.size();
+	slot.nameLength = (std::uint32_t)name.size();
+	uniformNames.append(name.data(), name.size());
 }
 
-void Shader::checkCompileErrors(unsigned int shader, std::string type)
+bool Shader::checkCompileErrors(unsigned int shader, std::string type)
 {
 	int success;
 	char infoLog[1024];
@@ -193,5 +700,6 @@ void Shader::checkCompileErrors(unsigned int shader, std::string type)
 			std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
 		}
 	}
+	return success != 0;
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,47 @@
+#ifndef UNIFORM_FIELD_H
+#define UNIFORM_FIELD_H
+
+#include <glad/glad.h> // include glad to get all the required OpenGL headers
+
+#include <glm/glm.hpp>
+
+#include "shader_s.h"
+
+#include <type_traits>
+
+// One plain uniform of a program with its resolved location.
+// The generated reflection structs (generated/shader_reflection.h) are made of these,
+// set() goes through glState, so an unchanged value costs no GL call.
+template <typename T>
+struct UniformField
+{
+	int location = -1;
+
+	void set(const T& value) const
+	{
+		if constexpr (std::is_same_v<T, bool>)
+			glState.uniform1i(location, (int)value);
+		else if constexpr (std::is_same_v<T, int>)
+			glState.uniform1i(location, value);
+		else if constexpr (std::is_same_v<T, unsigned int>)
+			glState.uniform1ui(location, value);
+		else if constexpr (std::is_same_v<T, float>)
+			glState.uniform1f(location, value);
+		else if constexpr (std::is_same_v<T, glm::vec2>)
+			glState.uniform2fv(location, &value[0]);
+		else if constexpr (std::is_same_v<T, glm::vec3>)
+			glState.uniform3fv(location, &value[0]);
+		else if constexpr (std::is_same_v<T, glm::vec4>)
+			glState.uniform4fv(location, &value[0]);
+		else if constexpr (std::is_same_v<T, glm::mat2>)
+			glState.uniformMatrix2fv(location, &value[0][0]);
+		else if constexpr (std::is_same_v<T, glm::mat3>)
+			glState.uniformMatrix3fv(location, &value[0][0]);
+		else if constexpr (std::is_same_v<T, glm::mat4>)
+			glState.uniformMatrix4fv(location, &value[0][0]);
+		else
+			static_assert(!sizeof(T), "unsupported uniform type");
+	}
+};
+
+#endif
@@ -0,0 +1,216 @@
+#ifndef TEXTURE_MANAGER_H
+#define TEXTURE_MANAGER_H
+
+#include <glad/glad.h> // include glad to get all the required OpenGL headers
+
+#include "gl_state_cache.h"
+#include "texture_streamer.h"
+#include "include/stb_image.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Owns every 2D texture loaded from an image file. A texture is decoded and uploaded once per
+// canonical path ("img/../img/a.png" and "img/a.png" are the same key), later requests get the
+// same GL name back and add a reference, release() deletes it with the last one.
+// With hashContents set the file bytes are hashed (FNV-1a 64) as well, so copies of one image
+// under different names also share a texture.
+// With a streamer set a new texture comes back at once holding its placeholder and is decoded
+// and uploaded in the background (texture_streamer.h), the name stays the same.
+class TextureManager
+{
+public:
+	struct Stats
+	{
+		unsigned int hits = 0;        // served from an already loaded path
+		unsigned int contentHits = 0; // new path, but its bytes were already loaded
+		unsigned int misses = 0;      // decoded and uploaded (or queued with a streamer)
+		unsigned int failures = 0;
+		unsigned int textures = 0;    // alive now
+	};
+
+	bool hashContents = false;
+	TextureStreamer* streamer = nullptr;
+
+	// GL name of the texture of path with one more reference, 0 when it cannot be loaded
+	unsigned int acquire(const std::string& path)
+	{
+		std::string key = canonicalPath(path);
+		auto found = byPath.find(key);
+		if (found != byPath.end()) {
+			entries[found->second].references++;
+			stats.hits++;
+			return found->second;
+		}
+
+		// the content hash needs the bytes now, otherwise a streamed file is read by a worker
+		std::vector<unsigned char> bytes;
+		std::error_code error;
+		bool readable = streamer && !hashContents ? std::filesystem::is_regular_file(key, error)
+			: TextureStreamer::readFile(key, bytes);
+		if (!readable) {
+			std::cout << "[Err : Texture] > msg : Failed to load at path : " << path << std::endl;
+			stats.failures++;
+			return 0;
+		}
+
+		std::uint64_t hash = 0;
+		if (hashContents) {
+			hash = hashBytes(bytes);
+			auto same = byHash.find(hash);
+			if (same != byHash.end()) {
+				Entry& entry = entries[same->second];
+				entry.references++;
+				entry.paths.push_back(key);
+				byPath[key] = same->second;
+				stats.contentHits++;
+				return same->second;
+			}
+		}
+
+		GLuint texture = 0;
+		if (streamer) {
+			texture = streamer->request(key, std::move(bytes));
+			std::cout << "[LOG] > msg : Texture " << key << " queued for streaming" << std::endl;
+		}
+		else {
+			texture = upload(bytes);
+			if (!texture) {
+				std::cout << "[Err : Texture] > msg : Failed to decode : " << path << std::endl;
+				stats.failures++;
+				return 0;
+			}
+			std::cout << "[LOG] > msg : Texture " << key << " loaded successfully" << std::endl;
+		}
+		stats.misses++;
+
+		Entry& entry = entries[texture];
+		entry.references = 1;
+		entry.paths.push_back(key);
+		entry.hash = hash;
+		entry.hashed = hashContents;
+		byPath[key] = texture;
+		if (hashContents)
+			byHash[hash] = texture;
+		return texture;
+	}
+
+	// drops one reference, the texture is deleted with the last one
+	void release(unsigned int texture)
+	{
+		auto found = entries.find(texture);
+		if (found == entries.end() || --found->second.references > 0)
+			return;
+		destroy(found->first, found->second);
+		entries.erase(found);
+	}
+
+	// deletes every texture whatever its references, before the context goes away
+	void clear()
+	{
+		for (auto& entry : entries)
+			destroy(entry.first, entry.second);
+		entries.clear();
+	}
+
+	Stats getStats() const
+	{
+		Stats current = stats;
+		current.textures = (unsigned int)entries.size();
+		return current;
+	}
+
+	void printStats() const
+	{
+		Stats current = getStats();
+		std::cout << "[LOG] > msg : textures : " << current.textures << " alive, requests hit " << current.hits
+			<< ", content hit " << current.contentHits << ", miss " << current.misses << ", failed " << current.failures << std::endl;
+	}
+
+private:
+	struct Entry
+	{
+		unsigned int references = 0;
+		std::vector<std::string> paths; // every canonical path that resolved to it
+		std::uint64_t hash = 0;
+		bool hashed = false;
+	};
+
+	std::unordered_map<GLuint, Entry> entries;
+	std::unordered_map<std::string, GLuint> byPath;
+	std::unordered_map<std::uint64_t, GLuint> byHash;
+	Stats stats;
+
+	static std::string canonicalPath(const std::string& path)
+	{
+		std::error_code error;
+		std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+		if (error)
+			canonical = std::filesystem::path(path).lexically_normal();
+		return canonical.generic_string();
+	}
+
+	static std::uint64_t hashBytes(const std::vector<unsigned char>& bytes)
+	{
+		// FNV-1a 64
+		std::uint64_t hash = 14695981039346656037ull;
+		for (unsigned char c : bytes) {
+			hash ^= c;
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	// decodes an encoded image and uploads it with mipmaps, 0 when stb_image cannot read it
+	static GLuint upload(const std::vector<unsigned char>& bytes)
+	{
+		int width, height, nrChannels;
+		unsigned char* data = stbi_load_from_memory(bytes.data(), (int)bytes.size(), &width, &height, &nrChannels, 0);
+		if (!data)
+			return 0;
+
+		GLenum format = GL_RGBA;
+		if (nrChannels == 1)
+			format = GL_RED;
+		else if (nrChannels == 2)
+			format = GL_RG;
+		else if (nrChannels == 3)
+			format = GL_RGB;
+
+		GLuint texture = 0;
+		glGenTextures(1, &texture);
+		glState.bindTexture(0, GL_TEXTURE_2D, texture);
+		// rows of 1 and 3 channel images are not 4 byte aligned
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glGenerateMipmap(GL_TEXTURE_2D);
+
+		// set the texture wrapping parameters
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		stbi_image_free(data);
+		return texture;
+	}
+
+	void destroy(GLuint texture, const Entry& entry)
+	{
+		for (const std::string& path : entry.paths)
+			byPath.erase(path);
+		if (entry.hashed)
+			byHash.erase(entry.hash);
+		if (streamer)
+			streamer->cancel(texture);
+		glState.forgetTexture(texture);
+		glDeleteTextures(1, &texture);
+	}
+};
+
+#endif
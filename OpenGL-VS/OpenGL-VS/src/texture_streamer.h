@@ -0,0 +1,314 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <glad/glad.h> // include glad to get all the required OpenGL headers
+
+#include "gl_state_cache.h"
+#include "include/stb_image.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Loads 2D textures without stalling the GL thread. request() hands back a texture name at
+// once, holding a 1x1 placeholder texel, and queues the file for a pool of worker threads
+// that read and decode it. update() runs on the GL thread once per frame: it copies decoded
+// images into an orphaned pixel unpack buffer and lets glTexImage2D source the same texture
+// name from it, until the frame's time budget is spent. Nothing has to rebind anything when
+// the real image arrives.
+class TextureStreamer
+{
+public:
+	struct Stats
+	{
+		unsigned int requested = 0;
+		unsigned int uploaded = 0;
+		unsigned int failed = 0;
+		unsigned int pending = 0;  // requested, neither uploaded nor failed yet
+		size_t uploadedBytes = 0;
+	};
+
+	// RGBA of the texel shown until the image is resident
+	unsigned char placeholder[4] = { 128, 128, 128, 255 };
+
+	~TextureStreamer()
+	{
+		stop();
+	}
+
+	// workers : decode threads, 0 picks one less than the cores (at least 1, at most 4)
+	void start(unsigned int workers = 0)
+	{
+		if (running)
+			return;
+		if (workers == 0) {
+			unsigned int cores = std::thread::hardware_concurrency();
+			workers = std::min(std::max(cores, 2u) - 1, 4u);
+		}
+		running = true;
+		for (unsigned int i = 0; i < workers; i++)
+			threads.emplace_back(&TextureStreamer::run, this);
+	}
+
+	// joins the workers, queued files that were not decoded yet are dropped
+	void stop()
+	{
+		if (!running)
+			return;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			running = false;
+		}
+		wake.notify_all();
+		for (std::thread& thread : threads)
+			thread.join();
+		threads.clear();
+	}
+
+	// GL thread, before the context goes away (after stop())
+	void destroy()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			jobs.clear();
+			for (Decoded& image : decoded)
+				stbi_image_free(image.pixels);
+			decoded.clear();
+		}
+		pending.clear();
+		if (pixelBuffer) {
+			glState.forgetBuffer(pixelBuffer);
+			glDeleteBuffers(1, &pixelBuffer);
+			pixelBuffer = 0;
+		}
+	}
+
+	// GL thread: a new texture holding the placeholder, the image of path replaces it once an
+	// update() uploads it. bytes are the file contents when the caller already read them,
+	// empty lets a worker read the file.
+	GLuint request(const std::string& path, std::vector<unsigned char> bytes = {})
+	{
+		GLuint texture = 0;
+		glGenTextures(1, &texture);
+		glState.bindTexture(0, GL_TEXTURE_2D, texture);
+		glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		// no mipmaps yet, a mipmapped filter would leave the texture incomplete
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		Job job{ texture, ++lastTicket, path, std::move(bytes) };
+		pending[texture] = job.ticket;
+		stats.requested++;
+		if (!running) {
+			// no workers, decode right here and upload on the next update()
+			Decoded image = decode(job);
+			std::lock_guard<std::mutex> lock(mutex);
+			decoded.push_back(std::move(image));
+			return texture;
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			jobs.push_back(std::move(job));
+		}
+		wake.notify_one();
+		return texture;
+	}
+
+	// GL thread, before the texture is deleted: its image is dropped instead of uploaded
+	void cancel(GLuint texture)
+	{
+		pending.erase(texture);
+	}
+
+	// GL thread, once per frame: uploads decoded images until budgetMs is spent (at least one
+	// when any is waiting). Returns how many became resident.
+	unsigned int update(double budgetMs)
+	{
+		auto start = std::chrono::steady_clock::now();
+		unsigned int uploaded = 0;
+		for (;;) {
+			Decoded image;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (decoded.empty())
+					break;
+				image = std::move(decoded.front());
+				decoded.pop_front();
+			}
+
+			// released (and maybe its name reused) while it was decoding
+			auto found = pending.find(image.texture);
+			if (found == pending.end() || found->second != image.ticket) {
+				stbi_image_free(image.pixels);
+				continue;
+			}
+			pending.erase(found);
+
+			if (!image.pixels) {
+				std::cout << "[Err : Texture] > msg : Failed to decode : " << image.path << std::endl;
+				stats.failed++;
+			}
+			else {
+				upload(image);
+				stbi_image_free(image.pixels);
+				uploaded++;
+			}
+
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+			if (elapsed.count() >= budgetMs)
+				break;
+		}
+		stats.uploaded += uploaded;
+		return uploaded;
+	}
+
+	// every requested texture is resident (or failed)
+	bool idle() const
+	{
+		return pending.empty();
+	}
+
+	Stats getStats() const
+	{
+		Stats current = stats;
+		current.pending = (unsigned int)pending.size();
+		return current;
+	}
+
+	void printStats() const
+	{
+		Stats current = getStats();
+		std::cout << "[LOG] > msg : texture streaming : " << current.uploaded << " of " << current.requested << " uploaded ("
+			<< current.uploadedBytes / 1024 << " KB), failed " << current.failed << ", pending " << current.pending << std::endl;
+	}
+
+	static bool readFile(const std::string& path, std::vector<unsigned char>& bytes)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+		bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		return !bytes.empty();
+	}
+
+private:
+	struct Job
+	{
+		GLuint texture;
+		unsigned int ticket; // tells a reused texture name from the one that was requested
+		std::string path;
+		std::vector<unsigned char> bytes;
+	};
+
+	struct Decoded
+	{
+		GLuint texture = 0;
+		unsigned int ticket = 0;
+		std::string path;
+		int width = 0;
+		int height = 0;
+		int channels = 0;
+		unsigned char* pixels = nullptr; // stb_image memory, nullptr when decoding failed
+	};
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::deque<Job> jobs;         // guarded by mutex
+	std::deque<Decoded> decoded;  // guarded by mutex
+	std::vector<std::thread> threads;
+	bool running = false;         // written under mutex, the workers wait on it
+
+	std::unordered_map<GLuint, unsigned int> pending; // GL thread only, texture -> ticket
+	unsigned int lastTicket = 0;
+	GLuint pixelBuffer = 0;
+	Stats stats;
+
+	// worker thread: reads and decodes queued files until stop()
+	void run()
+	{
+		for (;;) {
+			Job job;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [this] { return !running || !jobs.empty(); });
+				if (!running)
+					return;
+				job = std::move(jobs.front());
+				jobs.pop_front();
+			}
+			Decoded image = decode(job);
+			std::lock_guard<std::mutex> lock(mutex);
+			decoded.push_back(std::move(image));
+		}
+	}
+
+	static Decoded decode(Job& job)
+	{
+		Decoded image;
+		image.texture = job.texture;
+		image.ticket = job.ticket;
+		image.path = job.path;
+		if (job.bytes.empty() && !readFile(job.path, job.bytes))
+			return image;
+		image.pixels = stbi_load_from_memory(job.bytes.data(), (int)job.bytes.size(),
+			&image.width, &image.height, &image.channels, 0);
+		return image;
+	}
+
+	// GL thread: copies the pixels into the unpack buffer and respecifies the texture from it
+	void upload(const Decoded& image)
+	{
+		GLenum format = GL_RGBA;
+		if (image.channels == 1)
+			format = GL_RED;
+		else if (image.channels == 2)
+			format = GL_RG;
+		else if (image.channels == 3)
+			format = GL_RGB;
+		size_t size = (size_t)image.width * image.height * image.channels;
+
+		if (!pixelBuffer)
+			glGenBuffers(1, &pixelBuffer);
+		glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+		// orphan the storage the last upload may still be reading, the copy never waits for it
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+		void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		bool copied = false;
+		if (mapped) {
+			std::memcpy(mapped, image.pixels, size);
+			// GL_FALSE when the driver lost the mapping, the contents are undefined
+			copied = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+		}
+		if (!copied)
+			glBufferSubData(GL_PIXEL_UNPACK_BUFFER, 0, size, image.pixels);
+
+		glState.bindTexture(0, GL_TEXTURE_2D, image.texture);
+		// rows of 1 and 3 channel images are not 4 byte aligned
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, (void*)0);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glGenerateMipmap(GL_TEXTURE_2D);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		// client memory uploads elsewhere must not read from the buffer
+		glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+		stats.uploadedBytes += size;
+	}
+};
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef VERTEX_QUANTIZATION_H
+#define VERTEX_QUANTIZATION_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// Packed vertex, 16 bytes against the 32 of a full float Vertex:
+//   position  : 3 x unorm16 relative to the mesh bounds, the shader maps it back with
+//               position * positionScale + positionOffset (1 / 65535 of the extent per step)
+//   normal    : octahedral encoded into 2 x snorm16
+//   texCoords : 2 x half float
+// Drawn by shaders built with QUANTIZED_VERTICES (see basic_lighting.vs).
+struct QuantizedVertex {
+	uint16_t Position[4];  // w is padding, keeps the normal 4 byte aligned
+	int16_t Normal[2];
+	uint16_t TexCoords[2];
+};
+static_assert(sizeof(QuantizedVertex) == 16, "QuantizedVertex must stay 16 bytes");
+
+// what the shader needs to undo the position quantization
+struct QuantizationBounds {
+	glm::vec3 offset = glm::vec3(0.0f); // bounds minimum
+	glm::vec3 scale = glm::vec3(1.0f);  // bounds extent
+};
+
+namespace VertexQuantization
+{
+	inline uint16_t packUnorm16(float value)
+	{
+		value = std::min(std::max(value, 0.0f), 1.0f);
+		return (uint16_t)std::lround(value * 65535.0f);
+	}
+
+	inline int16_t packSnorm16(float value)
+	{
+		value = std::min(std::max(value, -1.0f), 1.0f);
+		return (int16_t)std::lround(value * 32767.0f);
+	}
+
+	// round to nearest even float -> IEEE half, denormals flushed to zero (texture coordinates never need them)
+	inline uint16_t packHalf(float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		uint16_t sign = (uint16_t)((bits >> 16) & 0x8000u);
+		int32_t exponent = (int32_t)((bits >> 23) & 0xFFu) - 127 + 15;
+		uint32_t mantissa = bits & 0x7FFFFFu;
+
+		if (((bits >> 23) & 0xFFu) == 0xFFu) // inf / nan
+			return (uint16_t)(sign | 0x7C00u | (mantissa ? 0x200u : 0u));
+		if (exponent <= 0)
+			return sign;
+		if (exponent >= 31)
+			return (uint16_t)(sign | 0x7C00u);
+
+		uint32_t half = ((uint32_t)exponent << 10) | (mantissa >> 13);
+		uint32_t rest = mantissa & 0x1FFFu;
+		if (rest > 0x1000u || (rest == 0x1000u && (half & 1u)))
+			half++; // may carry into the exponent, which is still the right rounding
+		return (uint16_t)(sign | half);
+	}
+
+	// unit vector -> point on the [-1, 1] square, the lower hemisphere folded over the diagonals
+	inline glm::vec2 octEncode(glm::vec3 n)
+	{
+		n /= std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+		glm::vec2 p(n.x, n.y);
+		if (n.z < 0.0f) {
+			p = glm::vec2((1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+				(1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+		}
+		return p;
+	}
+
+	// bounds of the positions, scale never 0 so a flat mesh still divides cleanly
+	template <typename V>
+	QuantizationBounds computeBounds(const V* vertices, size_t count)
+	{
+		QuantizationBounds bounds;
+		if (count == 0)
+			return bounds;
+		glm::vec3 lo = vertices[0].Position, hi = vertices[0].Position;
+		for (size_t i = 1; i < count; i++) {
+			lo = glm::min(lo, vertices[i].Position);
+			hi = glm::max(hi, vertices[i].Position);
+		}
+		bounds.offset = lo;
+		bounds.scale = glm::max(hi - lo, glm::vec3(1e-6f));
+		return bounds;
+	}
+
+	// V needs Position, Normal and TexCoords members like Vertex
+	template <typename V>
+	QuantizedVertex quantize(const V& vertex, const QuantizationBounds& bounds)
+	{
+		QuantizedVertex packed;
+		glm::vec3 position = (vertex.Position - bounds.offset) / bounds.scale;
+		packed.Position[0] = packUnorm16(position.x);
+		packed.Position[1] = packUnorm16(position.y);
+		packed.Position[2] = packUnorm16(position.z);
+		packed.Position[3] = 0;
+
+		float length = glm::length(vertex.Normal);
+		glm::vec2 oct = length > 0.0f ? octEncode(vertex.Normal / length) : glm::vec2(0.0f);
+		packed.Normal[0] = packSnorm16(oct.x);
+		packed.Normal[1] = packSnorm16(oct.y);
+
+		packed.TexCoords[0] = packHalf(vertex.TexCoords.x);
+		packed.TexCoords[1] = packHalf(vertex.TexCoords.y);
+		return packed;
+	}
+}
+
+#endif
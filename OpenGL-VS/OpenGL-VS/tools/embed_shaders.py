@@ -0,0 +1,146 @@
+#!/usr/bin/env python3
+"""Bakes every shader file into a C++ header for the EMBED_SHADERS build.
+
+Each .vs/.fs/.glsl file under the shader directory becomes a constexpr string with its
+comments, indentation and blank lines stripped. ShaderPreprocessor reads files (includes
+too) from this table when EMBED_SHADERS is defined, so startup opens no shader file.
+
+usage : embed_shaders.py <shader dir> <output header>
+(run from the project directory, the table is keyed by the path relative to it, the same
+path main.cpp hands to Shader)
+
+Every identifier a stage tests with #if / #elif must be #defined by the stage or its
+includes (the "#ifndef X / #define X 0" defaults), GLSL rejects an undefined one instead of
+reading it as 0, so a permutation that is not injected would fail to compile.
+"""
+
+import os
+import re
+import sys
+
+EXTENSIONS = (".vs", ".fs", ".gs", ".glsl")
+STAGES = (".vs", ".fs", ".gs")
+# MSVC limits a single string literal piece to 16380 bytes, longer sources are split
+PIECE = 16000
+
+
+def strip(source):
+    """Drops comments, indentation, trailing spaces and empty lines.
+
+    Newlines are kept between statements because preprocessor directives end at them.
+    """
+    source = re.sub(r"/\*.*?\*/", lambda m: "\n" * m.group(0).count("\n"), source, flags=re.S)
+    source = re.sub(r"//[^\n]*", "", source)
+    lines = []
+    for line in source.splitlines():
+        line = " ".join(line.split()) if not line.lstrip().startswith("#") else line.strip()
+        if line:
+            lines.append(line)
+    return "\n".join(lines) + "\n"
+
+
+def expand(path, seen=None):
+    """The source of path with its #include "..." lines replaced by the included files."""
+    seen = set() if seen is None else seen
+    if path in seen:
+        return ""
+    seen.add(path)
+    with open(path, encoding="utf-8", errors="replace") as f:
+        source = f.read()
+
+    def include(match):
+        return expand(os.path.normpath(os.path.join(os.path.dirname(path), match.group(1))), seen)
+
+    return re.sub(r'^[ \t]*#[ \t]*include[ \t]+"([^"]+)"[^\n]*', include, source, flags=re.M)
+
+
+def undefined_switches(path):
+    """Identifiers tested by #if / #elif in the stage at path that nothing #defines."""
+    source = strip(expand(path))
+    defined = set(re.findall(r"^#\s*define\s+(\w+)", source, flags=re.M))
+    tested = set()
+    for condition in re.findall(r"^#\s*(?:if|elif)\b(.*)$", source, flags=re.M):
+        # the operand of defined() may be undefined, that is what it asks
+        condition = re.sub(r"\bdefined\s*(?:\(\s*\w+\s*\)|\w+)", "", condition)
+        tested.update(re.findall(r"\b[A-Za-z_]\w*\b", condition))
+    builtin = {"GL_core_profile", "GL_es_profile", "GL_compatibility_profile", "__VERSION__", "__LINE__", "__FILE__"}
+    return sorted(tested - defined - builtin)
+
+
+def literal(text):
+    pieces = [text[i:i + PIECE] for i in range(0, len(text), PIECE)] or [""]
+    return "\n\t\t".join('R"glsl(%s)glsl"' % piece for piece in pieces)
+
+
+def main():
+    if len(sys.argv) != 3:
+        raise SystemExit(__doc__)
+    shader_dir, output = sys.argv[1], sys.argv[2]
+
+    files = []
+    for root, dirs, names in os.walk(shader_dir):
+        dirs[:] = sorted(d for d in dirs if d != "generated")
+        for name in sorted(names):
+            if name.endswith(EXTENSIONS):
+                path = os.path.join(root, name)
+                with open(path, encoding="utf-8", errors="replace") as f:
+                    source = strip(f.read())
+                if ")glsl\"" in source:
+                    raise SystemExit("%s contains the raw string delimiter" % path)
+                if name.endswith(STAGES):
+                    missing = undefined_switches(path)
+                    if missing:
+                        raise SystemExit("%s tests %s without a default #define" % (path, ", ".join(missing)))
+                files.append((os.path.normpath(path).replace("\\", "/"), source))
+
+    lines = [
+        "// Generated by tools/embed_shaders.py from src/shaders, do not edit.",
+        "#ifndef EMBEDDED_SHADERS_H",
+        "#define EMBEDDED_SHADERS_H",
+        "",
+        "#include <string_view>",
+        "",
+        "namespace EmbeddedShaders",
+        "{",
+        "",
+        "struct File",
+        "{",
+        "\tstd::string_view path;",
+        "\tstd::string_view source;",
+        "};",
+        "",
+        "inline constexpr File files[] = {",
+    ]
+    for path, source in files:
+        lines.append("\t{ \"%s\",\n\t\t%s }," % (path, literal(source)))
+    lines += [
+        "};",
+        "",
+        "// linear search, there are only a handful of files and it runs once per shader build",
+        "inline const File* find(std::string_view path)",
+        "{",
+        "\tfor (const File& file : files)",
+        "\t\tif (file.path == path)",
+        "\t\t\treturn &file;",
+        "\treturn nullptr;",
+        "}",
+        "}",
+        "",
+        "#endif",
+    ]
+
+    text = "\n".join(lines) + "\n"
+    try:
+        with open(output, encoding="utf-8") as f:
+            if f.read() == text:
+                return  # unchanged, keep the timestamp so nothing rebuilds
+    except OSError:
+        pass
+    os.makedirs(os.path.dirname(output), exist_ok=True)
+    with open(output, "w", encoding="utf-8", newline="\n") as f:
+        f.write(text)
+    print("embed_shaders : wrote %s" % output)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,305 @@
+#!/usr/bin/env python3
+"""Generates typed C++ uniform accessors from the GLSL sources.
+
+Every <name>.vs / <name>.fs pair under the shader directory is one program. Its plain
+uniforms become UniformField<T> members (nested structs and arrays keep their GLSL shape)
+that resolve their locations once per program link, and every std140 uniform block gets
+a struct of byte offsets. A uniform name typo in the render code is then a compile error
+instead of a silent location -1.
+
+usage : gen_shader_reflection.py <shader dir> <output header>
+(run from the project directory, the paths written into the header are relative to it)
+"""
+
+import os
+import re
+import sys
+
+# GLSL type -> (C++ type, std140 base alignment, std140 size)
+TYPES = {
+    "bool": ("bool", 4, 4),
+    "int": ("int", 4, 4),
+    "uint": ("unsigned int", 4, 4),
+    "float": ("float", 4, 4),
+    "vec2": ("glm::vec2", 8, 8),
+    "vec3": ("glm::vec3", 16, 12),
+    "vec4": ("glm::vec4", 16, 16),
+    "mat2": ("glm::mat2", 16, 32),
+    "mat3": ("glm::mat3", 16, 48),
+    "mat4": ("glm::mat4", 16, 64),
+    "sampler2D": ("int", 0, 0),
+    "samplerCube": ("int", 0, 0),
+    "samplerBuffer": ("int", 0, 0),
+}
+
+CPP_KEYWORDS = {"default", "union", "new", "delete", "register", "this", "class", "public", "private", "template", "typename", "namespace", "operator"}
+
+INCLUDE_RE = re.compile(r'^\s*#\s*include\s+["<]([^">]+)[">]')
+DEFINE_RE = re.compile(r'^\s*#\s*define\s+(\w+)\s+(\d+)\s*$')
+DECL_RE = re.compile(r'^\s*(\w+)\s+(\w+)\s*(?:\[\s*(\w+)\s*\])?\s*$')
+
+
+def expand(path, seen):
+    """Source with includes expanded (each file once), preprocessor conditionals kept."""
+    path = os.path.normpath(path)
+    if path in seen:
+        return ""
+    seen.add(path)
+    with open(path, encoding="utf-8", errors="replace") as f:
+        lines = f.read().splitlines()
+    out = []
+    for line in lines:
+        m = INCLUDE_RE.match(line)
+        if m:
+            out.append(expand(os.path.join(os.path.dirname(path), m.group(1)), seen))
+        else:
+            out.append(line)
+    return "\n".join(out)
+
+
+def strip_comments(source):
+    source = re.sub(r"/\*.*?\*/", "", source, flags=re.S)
+    return re.sub(r"//[^\n]*", "", source)
+
+
+def parse(source):
+    """Returns (structs, uniforms, blocks).
+
+    Conditionals are ignored on purpose: the reflection is the union of every permutation,
+    a field that a permutation compiles out simply resolves to location -1.
+    """
+    defines = {}
+    body = []
+    for line in strip_comments(source).splitlines():
+        m = DEFINE_RE.match(line)
+        if m:
+            defines.setdefault(m.group(1), int(m.group(2)))
+        if line.strip().startswith("#"):
+            continue
+        body.append(line)
+    text = "\n".join(body)
+
+    def members(block_text):
+        result = []
+        for statement in block_text.split(";"):
+            m = DECL_RE.match(" ".join(statement.split()))
+            if not m:
+                continue
+            glsl_type, name, count = m.groups()
+            if count is not None:
+                count = int(count) if count.isdigit() else defines[count]
+            result.append((glsl_type, name, count))
+        return result
+
+    structs = {}
+    for m in re.finditer(r"\bstruct\s+(\w+)\s*\{(.*?)\}\s*;", text, flags=re.S):
+        structs[m.group(1)] = members(m.group(2))
+
+    blocks = {}
+    for m in re.finditer(r"layout\s*\(\s*std140\s*\)\s*uniform\s+(\w+)\s*\{(.*?)\}\s*;", text, flags=re.S):
+        blocks[m.group(1)] = members(m.group(2))
+    text = re.sub(r"layout\s*\([^)]*\)\s*uniform\s+\w+\s*\{.*?\}\s*;", "", text, flags=re.S)
+
+    uniforms = []
+    for m in re.finditer(r"\buniform\s+([^;{]+);", text):
+        uniforms.extend(members(m.group(1)))
+    return structs, uniforms, blocks
+
+
+def std140_layout(glsl_type, structs):
+    """(base alignment, size) of a type in std140."""
+    if glsl_type in structs:
+        offset, align = 0, 16
+        for member_type, _, count in structs[glsl_type]:
+            member_align, member_size = std140_member(member_type, count, structs)
+            align = max(align, member_align)
+            offset = round_up(offset, member_align) + member_size
+        return align, round_up(offset, align)
+    _, align, size = TYPES[glsl_type]
+    return align, size
+
+
+def std140_member(glsl_type, count, structs):
+    align, size = std140_layout(glsl_type, structs)
+    if count is None:
+        return align, size
+    align = round_up(align, 16)
+    return align, round_up(size, align) * count
+
+
+def round_up(value, align):
+    return (value + align - 1) // align * align
+
+
+def block_offsets(prefix, glsl_type, count, base, structs, out):
+    """Flat name -> absolute offset list for one block member (array element 0)."""
+    if count is not None:
+        align, size = std140_layout(glsl_type, structs)
+        out.append((prefix + "_stride", round_up(size, round_up(align, 16))))
+    out.append((prefix, base))
+    if glsl_type in structs:
+        offset = 0
+        for member_type, name, member_count in structs[glsl_type]:
+            member_align, member_size = std140_member(member_type, member_count, structs)
+            offset = round_up(offset, member_align)
+            block_offsets(prefix + "_" + name, member_type, member_count, base + offset, structs, out)
+            offset += member_size
+
+
+def cpp_name(name):
+    return name + "_" if name in CPP_KEYWORDS else name
+
+
+def pascal(stem):
+    return "".join(part[:1].upper() + part[1:] for part in re.split(r"[_\-\s]+", stem) if part)
+
+
+class Writer:
+    def __init__(self):
+        self.lines = []
+
+    def __call__(self, indent, text=""):
+        self.lines.append("\t" * indent + text if text else "")
+
+
+def emit_fields(w, indent, members, structs):
+    for glsl_type, name, count in members:
+        suffix = "[%d]" % count if count is not None else ""
+        if glsl_type in structs:
+            w(indent, "struct %s_t" % glsl_type + " {")
+            emit_fields(w, indent + 1, structs[glsl_type], structs)
+            w(indent, "} %s%s;" % (cpp_name(name), suffix))
+        else:
+            w(indent, "UniformField<%s> %s%s;" % (TYPES[glsl_type][0], cpp_name(name), suffix))
+
+
+def emit_resolve(w, indent, members, structs, access, glsl_prefix):
+    for glsl_type, name, count in members:
+        field = access + cpp_name(name)
+        glsl = glsl_prefix + name
+        if count is not None:
+            w(indent, "for (int i = 0; i < %d; i++) {" % count)
+            w(indent + 1, 'std::string element = "%s[" + std::to_string(i) + "]";' % glsl)
+            if glsl_type in structs:
+                emit_resolve_struct(w, indent + 1, structs[glsl_type], structs, field + "[i].", "element")
+            else:
+                w(indent + 1, "%s[i].location = shader.uniformLocation(element);" % field)
+            w(indent, "}")
+        elif glsl_type in structs:
+            emit_resolve(w, indent, structs[glsl_type], structs, field + ".", glsl + ".")
+        else:
+            w(indent, '%s.location = shader.uniformLocation("%s");' % (field, glsl))
+
+
+def emit_resolve_struct(w, indent, members, structs, access, prefix_var):
+    for glsl_type, name, count in members:
+        if glsl_type in structs or count is not None:
+            raise SystemExit("nested aggregates inside uniform arrays are not supported (%s)" % name)
+        w(indent, '%s%s.location = shader.uniformLocation(%s + ".%s");' % (access, cpp_name(name), prefix_var, name))
+
+
+def main():
+    if len(sys.argv) != 3:
+        raise SystemExit(__doc__)
+    shader_dir, output = sys.argv[1], sys.argv[2]
+
+    stems = sorted({os.path.splitext(f)[0] for f in os.listdir(shader_dir) if f.endswith((".vs", ".fs"))})
+    programs = []
+    for stem in stems:
+        vs = os.path.join(shader_dir, stem + ".vs")
+        fs = os.path.join(shader_dir, stem + ".fs")
+        if not (os.path.exists(vs) and os.path.exists(fs)):
+            print("gen_shader_reflection : skipping %s (no matching .vs/.fs pair)" % stem)
+            continue
+        structs, uniforms, blocks = {}, [], {}
+        for path in (vs, fs):
+            s, u, b = parse(expand(path, set()))
+            structs.update(s)
+            blocks.update(b)
+            for entry in u:
+                if entry[1] not in [existing[1] for existing in uniforms]:
+                    uniforms.append(entry)
+        programs.append((stem, vs, fs, structs, uniforms, blocks))
+
+    # blocks are shared between programs through their binding points, emit each once
+    all_blocks = {}
+    for stem, _, _, structs, _, blocks in programs:
+        for name, members in blocks.items():
+            offsets = []
+            offset = 0
+            for glsl_type, member, count in members:
+                align, size = std140_member(glsl_type, count, structs)
+                offset = round_up(offset, align)
+                block_offsets(member, glsl_type, count, offset, structs, offsets)
+                offset += size
+            layout = (offsets, round_up(offset, 16))
+            if name in all_blocks and all_blocks[name] != layout:
+                raise SystemExit("uniform block %s is declared differently in %s" % (name, stem))
+            all_blocks[name] = layout
+
+    w = Writer()
+    w(0, "// Generated by tools/gen_shader_reflection.py from src/shaders, do not edit.")
+    w(0, "#ifndef SHADER_REFLECTION_H")
+    w(0, "#define SHADER_REFLECTION_H")
+    w(0)
+    w(0, '#include "../uniform_field.h"')
+    w(0)
+    w(0, "#include <cstddef>")
+    w(0, "#include <string>")
+    w(0)
+    w(0, "namespace ShaderReflection")
+    w(0, "{")
+    for name, (offsets, size) in sorted(all_blocks.items()):
+        w(0)
+        w(0, "// std140 byte offsets of uniform block %s (array members : element 0, plus _stride)" % name)
+        w(0, "struct %sBlock" % name)
+        w(0, "{")
+        w(1, "static constexpr std::size_t size = %d;" % size)
+        for member, offset in offsets:
+            w(1, "static constexpr std::size_t %s = %d;" % (member, offset))
+        w(0, "};")
+    for stem, vs, fs, structs, uniforms, _ in programs:
+        w(0)
+        w(0, "// %s + %s" % (os.path.basename(vs), os.path.basename(fs)))
+        w(0, "struct %s" % pascal(stem))
+        w(0, "{")
+        w(1, 'static constexpr const char* vertexPath = "%s";' % vs.replace("\\", "/"))
+        w(1, 'static constexpr const char* fragmentPath = "%s";' % fs.replace("\\", "/"))
+        w(0)
+        emit_fields(w, 1, uniforms, structs)
+        w(0)
+        w(1, "// resolves every location, only needed again after the program is relinked")
+        w(1, "void resolve(const Shader& shader)")
+        w(1, "{")
+        emit_resolve(w, 2, uniforms, structs, "", "")
+        w(2, "program = shader.ID;")
+        w(1, "}")
+        w(0)
+        w(1, "// cheap per-frame check that re-resolves when the shader was rebuilt (hot reload)")
+        w(1, "void bind(const Shader& shader)")
+        w(1, "{")
+        w(2, "if (shader.ID != program)")
+        w(3, "resolve(shader);")
+        w(1, "}")
+        w(0)
+        w(1, "unsigned int program = 0;")
+        w(0, "};")
+    w(0, "}")
+    w(0)
+    w(0, "#endif")
+
+    text = "\n".join(w.lines) + "\n"
+    try:
+        with open(output, encoding="utf-8") as f:
+            if f.read() == text:
+                return  # unchanged, keep the timestamp so nothing rebuilds
+    except OSError:
+        pass
+    os.makedirs(os.path.dirname(output), exist_ok=True)
+    with open(output, "w", encoding="utf-8", newline="\n") as f:
+        f.write(text)
+    print("gen_shader_reflection : wrote %s" % output)
+
+
+if __name__ == "__main__":
+    main()